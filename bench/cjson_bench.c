@@ -0,0 +1,176 @@
+#include "../src/cJSON.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define DEFAULT_ITERATIONS 20000
+#define SYNTHETIC_WORKSPACES 4096
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+static void* counting_malloc(size_t size)
+{
+	alloc_count++;
+	alloc_bytes += size;
+	return malloc(size);
+}
+
+static void counting_free(void* ptr)
+{
+	free(ptr);
+}
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* read_file(const char* path, size_t* len)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fclose(file);
+		return NULL;
+	}
+
+	char* buf = malloc(st.st_size + 1);
+	if (!buf) {
+		fclose(file);
+		return NULL;
+	}
+
+	*len = fread(buf, 1, st.st_size, file);
+	buf[*len] = '\0';
+	fclose(file);
+	return buf;
+}
+
+/* A large aerospace-like reply: one object per workspace with nested window
+ * lists, escaped strings and a mix of integer and fractional numbers. */
+static char* synthetic_document(size_t* len)
+{
+	cJSON* root = cJSON_CreateArray();
+	for (int i = 0; i < SYNTHETIC_WORKSPACES; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "ws-%d\t\"%d\"", i, i % 7);
+
+		cJSON* ws = cJSON_CreateObject();
+		cJSON_AddStringToObject(ws, "workspace", name);
+		cJSON_AddNumberToObject(ws, "monitor-id", i % 3);
+		cJSON_AddNumberToObject(ws, "scale", 1.0 + (i % 5) * 0.25);
+		cJSON_AddBoolToObject(ws, "focused", i == 0);
+
+		cJSON* windows = cJSON_AddArrayToObject(ws, "windows");
+		for (int w = 0; w < 4; ++w) {
+			cJSON* win = cJSON_CreateObject();
+			cJSON_AddNumberToObject(win, "window-id", i * 4 + w);
+			cJSON_AddStringToObject(win, "app-name", "Terminal\nWindow");
+			cJSON_AddItemToArray(windows, win);
+		}
+		cJSON_AddItemToArray(root, ws);
+	}
+
+	char* text = cJSON_Print(root);
+	cJSON_Delete(root);
+	*len = strlen(text);
+	return text;
+}
+
+static void bench_document(const char* label, const char* text, size_t len,
+	long iterations)
+{
+	cJSON* doc = cJSON_ParseWithLength(text, len);
+	if (!doc) {
+		fprintf(stderr, "%s: failed to parse, skipping\n", label);
+		return;
+	}
+
+	/* scale iterations so every document processes roughly the same volume */
+	long iters = iterations;
+	if (len > 4096)
+		iters = iterations * 4096 / (long)len + 1;
+
+	size_t before = alloc_count;
+	double start = now_seconds();
+	for (long i = 0; i < iters; ++i) {
+		cJSON* parsed = cJSON_ParseWithLength(text, len);
+		cJSON_Delete(parsed);
+	}
+	double parse_time = now_seconds() - start;
+	size_t parse_allocs = alloc_count - before;
+
+	size_t printed_len = cJSON_PrintLength(doc, false);
+
+	before = alloc_count;
+	start = now_seconds();
+	for (long i = 0; i < iters; ++i)
+		cJSON_free(cJSON_PrintUnformatted(doc));
+	double print_time = now_seconds() - start;
+	size_t print_allocs = alloc_count - before;
+
+	before = alloc_count;
+	start = now_seconds();
+	for (long i = 0; i < iters; ++i)
+		cJSON_free(cJSON_Print(doc));
+	double fmt_time = now_seconds() - start;
+	size_t fmt_allocs = alloc_count - before;
+
+	printf("%-36s %9zu %10.1f %8.2f %10.1f %8.2f %10.1f %8.2f\n",
+		label, len,
+		(double)len * iters / parse_time / 1e6, (double)parse_allocs / iters,
+		(double)printed_len * iters / print_time / 1e6, (double)print_allocs / iters,
+		(double)printed_len * iters / fmt_time / 1e6, (double)fmt_allocs / iters);
+
+	cJSON_Delete(doc);
+}
+
+int main(int argc, char** argv)
+{
+	long iterations = DEFAULT_ITERATIONS;
+	int first = 1;
+
+	if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+		iterations = strtol(argv[2], NULL, 10);
+		if (iterations <= 0) {
+			fprintf(stderr, "Error: invalid iteration count '%s'.\n", argv[2]);
+			return 1;
+		}
+		first = 3;
+	}
+
+	cJSON_Hooks hooks = { counting_malloc, counting_free };
+	cJSON_InitHooks(&hooks);
+
+	printf("%-36s %9s %10s %8s %10s %8s %10s %8s\n", "document", "bytes",
+		"parse MB/s", "allocs", "print MB/s", "allocs", "fmt MB/s", "allocs");
+
+	for (int i = first; i < argc; ++i) {
+		size_t len = 0;
+		char* text = read_file(argv[i], &len);
+		if (!text) {
+			fprintf(stderr, "%s: could not read file\n", argv[i]);
+			continue;
+		}
+		const char* label = strrchr(argv[i], '/');
+		bench_document(label ? label + 1 : argv[i], text, len, iterations);
+		free(text);
+	}
+
+	size_t len = 0;
+	char* text = synthetic_document(&len);
+	bench_document("synthetic (large)", text, len, iterations);
+	cJSON_free(text);
+
+	printf("total allocations: %zu (%zu bytes)\n", alloc_count, alloc_bytes);
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include "../src/haptic_queue.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POSTS_PER_THREAD 200000
+#define PRODUCERS 4
+/* roughly what MTActuatorActuate costs on real hardware */
+#define SLOW_ACTUATION_NS 2000000L
+#define SLOW_POSTS 8
+
+static _Atomic uint64_t slow_calls = 0;
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int slow_actuate(void* device, int32_t actuation)
+{
+	(void)device;
+	(void)actuation;
+	struct timespec ts = { 0, SLOW_ACTUATION_NS };
+	nanosleep(&ts, NULL);
+	atomic_fetch_add(&slow_calls, 1);
+	return 0;
+}
+
+static void slow_close(void* device)
+{
+	(void)device;
+}
+
+static int check(const char* label, haptic_queue_stats stats, uint64_t attempts)
+{
+	int ok = stats.posted + stats.dropped == attempts && stats.fired + stats.failed == stats.posted;
+	printf("%-28s posted %8llu dropped %8llu fired %8llu %s\n", label,
+		(unsigned long long)stats.posted, (unsigned long long)stats.dropped,
+		(unsigned long long)stats.fired, ok ? "" : "MISMATCH");
+	return ok;
+}
+
+/* wait for the drain thread to catch up so the counters are final */
+static haptic_queue_stats settled_stats(haptic_queue* queue)
+{
+	haptic_queue_stats stats = haptic_queue_get_stats(queue);
+	for (int i = 0; i < 1000 && stats.fired + stats.failed < stats.posted; ++i) {
+		struct timespec ts = { 0, 1000000L };
+		nanosleep(&ts, NULL);
+		stats = haptic_queue_get_stats(queue);
+	}
+	return stats;
+}
+
+static void* producer(void* arg)
+{
+	haptic_queue* queue = arg;
+	for (int i = 0; i < POSTS_PER_THREAD; ++i)
+		haptic_queue_post(queue, 3);
+	return NULL;
+}
+
+int main(void)
+{
+	int ok = 1;
+
+	/* single producer, null backend: cost of a post on the gesture thread */
+	haptic_queue* queue = haptic_queue_start(haptic_null_backend());
+	double start = now_seconds();
+	for (int i = 0; i < POSTS_PER_THREAD; ++i)
+		haptic_queue_post(queue, 3);
+	double elapsed = now_seconds() - start;
+	haptic_queue_stats stats = settled_stats(queue);
+	haptic_queue_stop(queue);
+	printf("post (1 producer, null):     %.1f ns/op\n", elapsed / POSTS_PER_THREAD * 1e9);
+	ok &= check("1 producer, null", stats, POSTS_PER_THREAD);
+
+	/* contended producers */
+	queue = haptic_queue_start(haptic_null_backend());
+	pthread_t threads[PRODUCERS];
+	start = now_seconds();
+	for (int i = 0; i < PRODUCERS; ++i)
+		pthread_create(&threads[i], NULL, producer, queue);
+	for (int i = 0; i < PRODUCERS; ++i)
+		pthread_join(threads[i], NULL);
+	elapsed = now_seconds() - start;
+	stats = settled_stats(queue);
+	haptic_queue_stop(queue);
+	printf("post (%d producers, null):    %.1f ns/op\n", PRODUCERS,
+		elapsed / (PRODUCERS * POSTS_PER_THREAD) * 1e9);
+	ok &= check("4 producers, null", stats, (uint64_t)PRODUCERS * POSTS_PER_THREAD);
+
+	/* slow device: the caller must not pay for the actuation */
+	haptic_backend slow = { NULL, slow_actuate, slow_close };
+	queue = haptic_queue_start(slow);
+	double worst = 0.0;
+	for (int i = 0; i < SLOW_POSTS; ++i) {
+		start = now_seconds();
+		haptic_queue_post(queue, 3);
+		double t = now_seconds() - start;
+		if (t > worst)
+			worst = t;
+	}
+	haptic_queue_stop(queue);
+	printf("post (slow %ldms device):     worst %.1f us, synchronous would be %.1f ms\n",
+		SLOW_ACTUATION_NS / 1000000, worst * 1e6, SLOW_ACTUATION_NS / 1e6);
+	if (atomic_load(&slow_calls) != SLOW_POSTS) {
+		printf("slow device fired %llu of %d\n", (unsigned long long)atomic_load(&slow_calls), SLOW_POSTS);
+		ok = 0;
+	}
+
+	return ok ? 0 : 1;
+}
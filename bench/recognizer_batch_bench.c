@@ -0,0 +1,148 @@
+#include "../src/recognizer.h"
+#include "../src/replay.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* A loaded corpus through recognizer_feed a frame at a time and through
+ * recognizer_feed_batch in replay-sized chunks, under the stock config and
+ * one with prediction and a vertical binding. The two must fire on the same
+ * frames with the same bindings, directions and prediction flags, and leave
+ * the recognizer byte for byte the same after every chunk, displacement
+ * history included; the timing is the best of several rounds of each. */
+
+#define CHUNK 1024
+#define ROUNDS 15
+
+typedef struct {
+	size_t frame;
+	const Binding* binding;
+	swipe_direction direction;
+	bool predicted;
+} fired;
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start(recognizer* state)
+{
+	recognizer_init(state);
+	state->quiet = true;
+}
+
+static double time_online(const replay_corpus* corpus, const Config* config)
+{
+	recognizer state;
+	start(&state);
+	double begin = now_seconds();
+	size_t count = 0;
+	for (size_t f = 0; f < corpus->frame_count; ++f)
+		count += recognizer_feed(&state, config, &corpus->frames[f], MODIFIER_NONE) != NULL;
+	double elapsed = now_seconds() - begin;
+	return count ? elapsed : elapsed + 1.0;
+}
+
+static double time_batch(const replay_corpus* corpus, const Config* config)
+{
+	static recognizer_trigger triggers[CHUNK];
+	recognizer state;
+	start(&state);
+	double begin = now_seconds();
+	size_t count = 0;
+	for (size_t chunk = 0; chunk < corpus->frame_count; chunk += CHUNK) {
+		size_t n = corpus->frame_count - chunk < CHUNK ? corpus->frame_count - chunk : CHUNK;
+		count += recognizer_feed_batch(&state, config, &corpus->frames[chunk], n, MODIFIER_NONE, triggers,
+			CHUNK);
+	}
+	double elapsed = now_seconds() - begin;
+	return count ? elapsed : elapsed + 1.0;
+}
+
+/* Both paths chunk by chunk in lockstep; returns the mismatches. */
+static size_t compare(const replay_corpus* corpus, const Config* config, size_t* trigger_count)
+{
+	static recognizer_trigger triggers[CHUNK];
+	static fired online[CHUNK];
+	recognizer online_state, batch_state;
+	start(&online_state);
+	start(&batch_state);
+	size_t mismatches = 0;
+	*trigger_count = 0;
+	for (size_t chunk = 0; chunk < corpus->frame_count; chunk += CHUNK) {
+		size_t n = corpus->frame_count - chunk < CHUNK ? corpus->frame_count - chunk : CHUNK;
+		size_t online_count = 0;
+		for (size_t f = 0; f < n; ++f) {
+			const Binding* binding = recognizer_feed(&online_state, config, &corpus->frames[chunk + f],
+				MODIFIER_NONE);
+			if (binding)
+				online[online_count++] = (fired) { f, binding, online_state.direction, online_state.predicted };
+		}
+		size_t batch_count = recognizer_feed_batch(&batch_state, config, &corpus->frames[chunk], n,
+			MODIFIER_NONE, triggers, CHUNK);
+
+		mismatches += online_count > batch_count ? online_count - batch_count : batch_count - online_count;
+		for (size_t t = 0; t < online_count && t < batch_count; ++t)
+			if (online[t].frame != triggers[t].frame || online[t].binding != triggers[t].binding
+				|| online[t].direction != triggers[t].direction || online[t].predicted != triggers[t].predicted)
+				mismatches++;
+		if (memcmp(&online_state, &batch_state, sizeof(recognizer)) != 0)
+			mismatches++;
+		*trigger_count += online_count;
+	}
+	return mismatches;
+}
+
+static size_t run(const char* label, const replay_corpus* corpus, const Config* config)
+{
+	double best_online = 1e9, best_batch = 1e9;
+	for (int r = 0; r < ROUNDS; ++r) {
+		double elapsed = time_online(corpus, config);
+		best_online = elapsed < best_online ? elapsed : best_online;
+		elapsed = time_batch(corpus, config);
+		best_batch = elapsed < best_batch ? elapsed : best_batch;
+	}
+
+	size_t triggers;
+	size_t mismatches = compare(corpus, config, &triggers);
+	printf("%-12s recognizer_feed %6.2f ns/frame   recognizer_feed_batch %6.2f ns/frame (%.2fx)   "
+		   "%zu triggers, %zu mismatches\n",
+		label, best_online / corpus->frame_count * 1e9, best_batch / corpus->frame_count * 1e9,
+		best_online / best_batch, triggers, mismatches);
+	return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s trace...\n", argv[0]);
+		return 2;
+	}
+	replay_corpus corpus = { 0 };
+	for (int i = 1; i < argc; ++i)
+		if (!replay_corpus_load(&corpus, argv[i]))
+			return 1;
+	printf("%zu frames, chunks of %d\n", corpus.frame_count, CHUNK);
+
+	Config stock = default_config();
+	Config predicting;
+	if (!config_parse("{\"thresholds\": \"fast\", \"prediction\": true, \"bindings\": "
+					  "[{\"direction\": \"up\", \"command\": \"workspace-back-and-forth\"}]}",
+			&predicting)) {
+		fprintf(stderr, "bad config\n");
+		return 1;
+	}
+
+	size_t mismatches = run("stock", &corpus, &stock);
+	mismatches += run("prediction", &corpus, &predicting);
+
+	config_free(&predicting);
+	config_free(&stock);
+	replay_corpus_free(&corpus);
+	return mismatches == 0 ? 0 : 1;
+}
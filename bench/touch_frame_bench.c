@@ -0,0 +1,112 @@
+#include "../src/touch_frame.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* The per-frame reductions over three-finger frames, as a replay or tuning
+ * sweep walks them: the old scalar loop over touch structs against
+ * touch_frame_means over the float32 layout, once on frames that fit in
+ * cache and once streaming a corpus-sized array from memory. */
+
+#define FRAMES 200000
+#define CACHED_FRAMES 4000
+#define FINGERS 3
+#define ROUNDS 20
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static float uniform(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (float)((rng_state >> 40) * (1.0 / 16777216.0));
+}
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* best round of each, the machine is rarely quiet for all of them */
+static void measure(const char* label, const touch* touches, const touch_frame* frames, int count, int rounds)
+{
+	volatile float sink;
+	float acc = 0.0f;
+	double scalar = 1e9, vector = 1e9;
+	for (int r = 0; r < rounds; ++r) {
+		/* the recognizer's loop before touch_frame */
+		double start = now_seconds();
+		for (int f = 0; f < count; ++f) {
+			const touch* contacts = &touches[f * FINGERS];
+			float sumX = 0.0f, sumVelX = 0.0f, sumY = 0.0f;
+			for (int i = 0; i < FINGERS; ++i) {
+				sumX += contacts[i].x;
+				sumVelX += contacts[i].velocity;
+				sumY += contacts[i].y;
+			}
+			acc += sumX / FINGERS + sumVelX / FINGERS + sumY / FINGERS;
+		}
+		double elapsed = (now_seconds() - start) / count;
+		scalar = elapsed < scalar ? elapsed : scalar;
+
+		start = now_seconds();
+		for (int f = 0; f < count; ++f) {
+			frame_means means = touch_frame_means(&frames[f]);
+			acc += means.x + means.velocity + means.y;
+		}
+		elapsed = (now_seconds() - start) / count;
+		vector = elapsed < vector ? elapsed : vector;
+	}
+	sink = acc;
+	(void)sink;
+	printf("%-26s touch loop %6.2f ns/frame   touch_frame %6.2f ns/frame\n", label, scalar * 1e9,
+		vector * 1e9);
+}
+
+int main(void)
+{
+	touch* touches = malloc(sizeof(touch) * FRAMES * FINGERS);
+	touch_frame* frames = NULL;
+	if (!touches || posix_memalign((void**)&frames, 64, sizeof(touch_frame) * FRAMES) != 0) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int f = 0; f < FRAMES; ++f) {
+		for (int i = 0; i < FINGERS; ++i) {
+			touch* t = &touches[f * FINGERS + i];
+			t->id = (uint64_t)i + 1;
+			t->x = uniform();
+			t->y = uniform();
+			t->phase = 2;
+			t->timestamp = f * 0.008;
+			t->velocity = uniform() * 2.0f - 1.0f;
+		}
+		touch_frame_from_touches(&frames[f], 1, &touches[f * FINGERS], FINGERS);
+	}
+
+	/* both must agree to float rounding */
+	int mismatches = 0;
+	for (int f = 0; f < FRAMES; ++f) {
+		frame_means means = touch_frame_means(&frames[f]);
+		float sumX = 0.0f;
+		for (int i = 0; i < FINGERS; ++i)
+			sumX += (float)touches[f * FINGERS + i].x;
+		float d = means.x - sumX / FINGERS;
+		if (d > 1e-6f || d < -1e-6f)
+			mismatches++;
+	}
+
+	printf("touch_frame: %zu bytes per frame (touch: %zu, %zu for %d contacts)\n", sizeof(touch_frame),
+		sizeof(touch), sizeof(touch) * FRAME_CONTACTS, FRAME_CONTACTS);
+	measure("centroid+velocity, cached", touches, frames, CACHED_FRAMES, ROUNDS * 50);
+	measure("centroid+velocity, memory", touches, frames, FRAMES, ROUNDS);
+	printf("mismatches beyond 1e-6: %d of %d\n", mismatches, FRAMES);
+
+	free(touches);
+	free(frames);
+	return mismatches == 0 ? 0 : 1;
+}
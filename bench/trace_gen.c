@@ -0,0 +1,210 @@
+#include "../src/touch_trace.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Writes a labelled synthetic trace corpus: three-finger swipes of varied
+ * length and speed, plus gestures that must not trigger (resting fingers,
+ * small drifts, aborted swipes and vertical scrolls). Frames come at ~120Hz
+ * with sensor noise and the occasional coalesced event, fingers land and
+ * lift one at a time. With a dropout rate, that share of gestures has one
+ * finger lose contact for a frame or two mid movement and come back under a
+ * new id, as fingers do on real trackpads. A stand-in until real recordings
+ * are collected with AEROSPACE_SWIPE_RECORD. */
+
+#define FINGERS 3
+#define FRAME_DT 0.00833
+#define POSITION_NOISE 0.001
+#define FINGER_SPACING_X 0.08
+#define FINGER_SPACING_Y 0.02
+#define EDGE 0.02 /* kept clear of the trackpad's edges, noise included */
+
+enum { SWIPE, REST, DRIFT, ABORT, VERTICAL, KINDS };
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dull;
+static uint64_t next_id = 1;
+static double now = 100.0;
+static double dropout_rate = 0.0;
+
+static double uniform(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(void)
+{
+	double u = uniform(), v = uniform();
+	return sqrt(-2.0 * log(u + 1e-300)) * cos(6.283185307179586 * v);
+}
+
+/* Where a hand span wide starts so that a movement of travel keeps it on
+ * the trackpad, drawn from u uniform in [0, 1). */
+static double place(double u, double span, double travel)
+{
+	double low = EDGE + (travel < 0.0 ? -travel : 0.0);
+	double high = 1.0 - EDGE - span - (travel > 0.0 ? travel : 0.0);
+	return low + u * (high - low);
+}
+
+static double clamp_unit(double v)
+{
+	return v < 0.0 ? 0.0 : v > 1.0 ? 1.0 : v;
+}
+
+static double next_dt(void)
+{
+	if (uniform() < 0.05)
+		return 0.001;
+	return FRAME_DT + (uniform() - 0.5) * 0.002;
+}
+
+/* minimum-jerk profile, the usual model of a reaching movement */
+static double min_jerk(double s)
+{
+	if (s <= 0.0)
+		return 0.0;
+	if (s >= 1.0)
+		return 1.0;
+	return s * s * s * (10.0 - 15.0 * s + 6.0 * s * s);
+}
+
+/* last_phase applies to the last finger, which is landing or lifting */
+static void emit(touch* touches, int count, int phase, int last_phase)
+{
+	touch noisy[FINGERS];
+	for (int i = 0; i < count; ++i) {
+		noisy[i] = touches[i];
+		/* positions are normalized, as the trackpad reports them */
+		noisy[i].x = clamp_unit(noisy[i].x + gaussian() * POSITION_NOISE);
+		noisy[i].y = clamp_unit(noisy[i].y + gaussian() * POSITION_NOISE);
+		noisy[i].timestamp = now;
+		noisy[i].phase = i == count - 1 ? last_phase : phase;
+	}
+	touch_trace_write_frame(stdout, noisy, count);
+	now += next_dt();
+}
+
+static void gesture(int kind)
+{
+	/* drawn first, the start is placed once the movement is known */
+	double start_x = uniform(), start_y = uniform();
+	double dx = 0.0, dy = 0.0, duration = 0.3, back = 0.0;
+	int label = TRACE_NONE;
+	switch (kind) {
+	case SWIPE: {
+		int right = uniform() < 0.5;
+		label = right ? 1 : 0; /* SWIPE_RIGHT : SWIPE_LEFT */
+		dx = (0.18 + uniform() * 0.3) * (right ? 1 : -1);
+		duration = 0.1 + uniform() * 0.4;
+		break;
+	}
+	case REST:
+		duration = 0.3 + uniform() * 0.7;
+		break;
+	case DRIFT:
+		dx = (uniform() - 0.5) * 0.12;
+		dy = (uniform() - 0.5) * 0.04;
+		duration = 0.3 + uniform() * 0.5;
+		break;
+	case ABORT:
+		dx = (uniform() < 0.5 ? 1 : -1) * (0.05 + uniform() * 0.04);
+		duration = 0.25 + uniform() * 0.2;
+		back = 1.0;
+		break;
+	case VERTICAL:
+		dy = (uniform() < 0.5 ? 1 : -1) * (0.2 + uniform() * 0.2);
+		dx = (uniform() - 0.5) * 0.04;
+		duration = 0.15 + uniform() * 0.3;
+		break;
+	}
+
+	touch fingers[FINGERS];
+	memset(fingers, 0, sizeof(fingers));
+	double x0 = place(start_x, FINGER_SPACING_X * (FINGERS - 1), dx);
+	double y0 = place(start_y, FINGER_SPACING_Y * (FINGERS - 1), dy);
+	for (int f = 0; f < FINGERS; ++f) {
+		fingers[f].id = next_id++;
+		fingers[f].x = x0 + FINGER_SPACING_X * f;
+		fingers[f].y = y0 + FINGER_SPACING_Y * f;
+	}
+
+	touch_trace_write_label(stdout, label);
+
+	/* land one finger at a time */
+	for (int count = 1; count <= FINGERS; ++count)
+		emit(fingers, count, 4, 1);
+	for (int i = 0; i < 2; ++i)
+		emit(fingers, FINGERS, 4, 4);
+
+	/* the last finger drops out at dropout_at of the movement, for
+	 * dropout_frames frames after the one it lifts in; the draws only happen
+	 * with a dropout rate so the default corpus stays the same */
+	double dropout_at = 2.0;
+	int dropout_frames = 0;
+	if (dropout_rate > 0.0 && uniform() < dropout_rate) {
+		dropout_at = 0.1 + uniform() * 0.5;
+		dropout_frames = 1 + (int)(uniform() * 4);
+	}
+
+	int missing = 0;
+	bool landing = false;
+	touch moved[FINGERS];
+	double start = now;
+	for (;;) {
+		double s = (now - start) / duration;
+		/* an aborted swipe goes out for the first half and comes back */
+		double p = back > 0.0 ? min_jerk(s * 2.0) - min_jerk(s * 2.0 - 1.0) : min_jerk(s);
+		for (int f = 0; f < FINGERS; ++f) {
+			moved[f] = fingers[f];
+			moved[f].x += dx * p;
+			moved[f].y += dy * p;
+		}
+		if (s >= dropout_at && dropout_frames > 0) {
+			if (missing == 0) {
+				emit(moved, FINGERS, 2, 8);
+				missing = dropout_frames;
+				continue;
+			}
+			emit(moved, FINGERS - 1, 2, 2);
+			if (--missing == 0) {
+				fingers[FINGERS - 1].id = next_id++;
+				dropout_frames = 0;
+				landing = true;
+			}
+			continue;
+		}
+		emit(moved, FINGERS, 2, landing ? 1 : 2);
+		landing = false;
+		if (s >= 1.0)
+			break;
+	}
+
+	/* lift one finger at a time */
+	for (int count = FINGERS; count > 0; --count)
+		emit(moved, count, 4, 8);
+	now += 0.6;
+}
+
+int main(int argc, char** argv)
+{
+	int gestures = argc > 1 ? atoi(argv[1]) : 1000;
+	if (argc > 2)
+		rng_state ^= strtoull(argv[2], NULL, 10) * 0x9e3779b97f4a7c15ull;
+	if (argc > 3)
+		dropout_rate = atof(argv[3]);
+
+	printf("# synthetic corpus: %d gestures, swipes and gestures that must not trigger, %.0f%% with a dropout\n",
+		gestures, dropout_rate * 100.0);
+	for (int i = 0; i < gestures; ++i) {
+		/* half swipes, half the kinds that must not fire */
+		int kind = uniform() < 0.5 ? SWIPE : 1 + (int)(uniform() * (KINDS - 1));
+		gesture(kind);
+	}
+	return 0;
+}
@@ -0,0 +1,158 @@
+#include "../src/velocity.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Synthetic three-finger frames at ~120Hz with sensor noise and the odd
+ * coalesced event that arrives a millisecond after the previous one. Compares
+ * the old rule (finite difference, two consecutive frames over the threshold)
+ * with the regression estimate firing on its first qualifying frame. */
+
+#define FINGERS 3
+#define FRAME_DT 0.00833
+#define THRESHOLD 0.75
+#define POSITION_NOISE 0.0015
+#define SWIPES 2000
+#define RESTING_FRAMES 120000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static double uniform(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(void)
+{
+	double u = uniform(), v = uniform();
+	return sqrt(-2.0 * log(u + 1e-300)) * cos(6.283185307179586 * v);
+}
+
+static double next_dt(void)
+{
+	if (uniform() < 0.05)
+		return 0.001;
+	return FRAME_DT + (uniform() - 0.5) * 0.002;
+}
+
+typedef struct {
+	double last_t[FINGERS];
+	double last_x[FINGERS];
+	bool primed;
+	int consecutive;
+	velocity_window windows[FINGERS];
+} detector;
+
+static void detector_reset(detector* d)
+{
+	d->primed = false;
+	d->consecutive = 0;
+	for (int f = 0; f < FINGERS; ++f)
+		velocity_reset(&d->windows[f]);
+}
+
+/* feeds one frame; reports whether each rule fires on it */
+static void detector_feed(detector* d, double t, const double* x, bool* fd_fires, bool* ls_fires)
+{
+	double fd = 0.0, ls = 0.0;
+	for (int f = 0; f < FINGERS; ++f) {
+		if (d->primed && t > d->last_t[f])
+			fd += (x[f] - d->last_x[f]) / (t - d->last_t[f]);
+		d->last_t[f] = t;
+		d->last_x[f] = x[f];
+
+		double vx;
+		velocity_add(&d->windows[f], t, x[f]);
+		velocity_estimate(&d->windows[f], &vx);
+		ls += vx;
+	}
+	d->primed = true;
+	fd /= FINGERS;
+	ls /= FINGERS;
+
+	d->consecutive = fabs(fd) > THRESHOLD ? d->consecutive + 1 : 0;
+	*fd_fires = d->consecutive >= 2;
+	*ls_fires = fabs(ls) > THRESHOLD;
+}
+
+int main(void)
+{
+	detector d;
+	double x[FINGERS];
+	bool fd_fires, ls_fires;
+
+	/* resting fingers: every trigger is a false positive */
+	detector_reset(&d);
+	long fd_false = 0, ls_false = 0;
+	double t = 0.0;
+	for (int frame = 0; frame < RESTING_FRAMES; ++frame) {
+		t += next_dt();
+		for (int f = 0; f < FINGERS; ++f)
+			x[f] = 0.3 + 0.1 * f + gaussian() * POSITION_NOISE;
+		detector_feed(&d, t, x, &fd_fires, &ls_fires);
+		fd_false += fd_fires;
+		ls_false += ls_fires;
+	}
+	printf("resting, %d frames:           finite difference x2 %ld false   regression %ld false\n",
+		RESTING_FRAMES, fd_false, ls_false);
+
+	/* swipes ramping up to 1-2.5 units/s over 40ms */
+	double fd_ms = 0.0, ls_ms = 0.0;
+	int fd_missed = 0, ls_missed = 0, fd_detected = 0, ls_detected = 0;
+	for (int s = 0; s < SWIPES; ++s) {
+		detector_reset(&d);
+		double peak = 1.0 + 1.5 * uniform();
+		double start[FINGERS];
+		for (int f = 0; f < FINGERS; ++f)
+			start[f] = 0.2 + 0.1 * f;
+
+		double fd_at = -1.0, ls_at = -1.0;
+		double travelled = 0.0;
+		t = 0.0;
+		for (int frame = 0; frame < 30 && (fd_at < 0 || ls_at < 0); ++frame) {
+			double dt = next_dt();
+			double speed = peak * fmin(1.0, (t + dt) / 0.04);
+			travelled += speed * dt;
+			t += dt;
+			for (int f = 0; f < FINGERS; ++f)
+				x[f] = start[f] + travelled + gaussian() * POSITION_NOISE;
+			detector_feed(&d, t, x, &fd_fires, &ls_fires);
+			if (fd_fires && fd_at < 0)
+				fd_at = t;
+			if (ls_fires && ls_at < 0)
+				ls_at = t;
+		}
+		if (fd_at < 0)
+			fd_missed++;
+		else
+			fd_ms += fd_at * 1e3, fd_detected++;
+		if (ls_at < 0)
+			ls_missed++;
+		else
+			ls_ms += ls_at * 1e3, ls_detected++;
+	}
+	printf("swipes, %d:                  finite difference x2 %.1f ms (%d missed)   regression %.1f ms (%d missed)\n",
+		SWIPES, fd_ms / fd_detected, fd_missed, ls_ms / ls_detected, ls_missed);
+
+	/* estimator cost on the conversion path */
+	velocity_window window;
+	velocity_reset(&window);
+	double sink = 0.0, vx;
+	struct timespec a, b;
+	clock_gettime(CLOCK_MONOTONIC, &a);
+	for (int i = 0; i < 1000000; ++i) {
+		velocity_add(&window, i * FRAME_DT, i * 0.001);
+		velocity_estimate(&window, &vx);
+		sink += vx;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &b);
+	printf("add + estimate:               %.1f ns/sample (%.0f)\n",
+		((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / 1e6, sink > 0 ? 1.0 : 0.0);
+
+	return ls_false <= fd_false && ls_missed <= fd_missed ? 0 : 1;
+}
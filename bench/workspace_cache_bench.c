@@ -0,0 +1,199 @@
+#include "../src/aerospace.h"
+#include "../src/config.h"
+#include "../src/executor.h"
+#include "../src/stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The executor's per-monitor workspace cache against swipe-aerospace-mock
+ * started with -w 300 -m 3: a hundred workspaces on each of three
+ * monitors. One connection swipes through the executor, a second one plays
+ * the user at the keyboard, moving the focus and workspaces behind the
+ * cache's back, and checks where every swipe landed, also after the
+ * daemon's own commands and after a listing ages out. Swipes are timed with
+ * the cache and with a listing fetched every time, as skip_empty does. */
+
+#define MOCK_WORKSPACES 300
+#define MOCK_MONITORS 3
+#define PER_MONITOR (MOCK_WORKSPACES / MOCK_MONITORS)
+#define SWIPES 1000
+
+static Aerospace* outside;
+static int failures;
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the mock's names: 1 to 9, then ws-10 on */
+static const char* name_of(int index)
+{
+	static char name[32];
+	snprintf(name, sizeof(name), index < 9 ? "%d" : "ws-%d", index + 1);
+	return name;
+}
+
+static double counter(const char* name)
+{
+	char* json = stats_snapshot_json();
+	cJSON* snapshot = cJSON_Parse(json);
+	double value = cJSON_GetNumberValue(cJSON_GetObjectItem(cJSON_GetObjectItem(snapshot, "counters"), name));
+	cJSON_Delete(snapshot);
+	cJSON_free(json);
+	return value;
+}
+
+static void run_outside(const char* const* args, int argc)
+{
+	aerospace_request req;
+	if (!aerospace_request_build(&req, args, argc)) {
+		fprintf(stderr, "Error: out of memory\n");
+		exit(1);
+	}
+	char* error = aerospace_execute(outside, &req, NULL);
+	if (error) {
+		printf("  '%s' failed: %s\n", args[0], error);
+		failures++;
+		free(error);
+	}
+	aerospace_request_free(&req);
+}
+
+static void expect_focus(const char* what, int index, int monitor)
+{
+	static workspace_table focus;
+	char expected[32];
+	snprintf(expected, sizeof(expected), "%s", name_of(index));
+	if (!aerospace_focused_workspace(outside, &focus) || strcmp(workspace_table_name(&focus, 0), expected) != 0
+		|| focus.monitor != monitor) {
+		printf("  %s: on %s (monitor %d), expected %s (monitor %d)\n", what,
+			focus.count ? workspace_table_name(&focus, 0) : "?", focus.monitor, expected, monitor);
+		failures++;
+	}
+}
+
+static void expect_counts(const char* what, double hits_before, double hits, double listings_before,
+	double listings)
+{
+	double got_hits = counter("workspace_hits") - hits_before;
+	double got_listings = counter("workspace_listings") - listings_before;
+	if (got_hits != hits || got_listings != listings) {
+		printf("  %s: %.0f hits and %.0f listings, expected %.0f and %.0f\n", what, got_hits, got_listings,
+			hits, listings);
+		failures++;
+	}
+}
+
+/* Swipes count times, returning seconds per swipe. */
+static double swipe(Aerospace* client, const Config* config, const Binding* binding, int count)
+{
+	double start = now_seconds();
+	for (int i = 0; i < count; ++i)
+		execute_binding(client, NULL, config, binding, stats_now_ns());
+	return (now_seconds() - start) / count;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s mock.sock   (swipe-aerospace-mock -w %d -m %d mock.sock)\n", argv[0],
+			MOCK_WORKSPACES, MOCK_MONITORS);
+		return 2;
+	}
+	/* the mock may still be starting */
+	struct timespec pause = { 0, 20000000 };
+	for (int i = 0; i < 100 && access(argv[1], F_OK) != 0; ++i)
+		nanosleep(&pause, NULL);
+	nanosleep(&pause, NULL);
+	Aerospace* client = aerospace_new(argv[1]);
+	outside = aerospace_new(argv[1]);
+
+	Config config = default_config();
+	config.skip_empty = false;
+	const Binding* next = config_binding(&config, config.fingers, SWIPE_RIGHT, MODIFIER_NONE);
+
+	/* through monitor 1's hundred, ten times round: one listing */
+	double hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	double cached = swipe(client, &config, next, SWIPES);
+	expect_focus("cached swipes", SWIPES % PER_MONITOR, 1);
+	expect_counts("cached swipes", hits, SWIPES - 1, listings, 1);
+
+	/* the focus goes to monitor 2, which is listed once */
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	run_outside((const char*[]) { "focus-monitor", "2" }, 2);
+	swipe(client, &config, next, 2);
+	expect_focus("other monitor", PER_MONITOR + 2, 2);
+	expect_counts("other monitor", hits, 1, listings, 1);
+
+	/* back on monitor 1, whose listing is still good, somewhere else */
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	run_outside((const char*[]) { "workspace", name_of(49) }, 2);
+	swipe(client, &config, next, 1);
+	expect_focus("focus moved outside", 50, 1);
+	expect_counts("focus moved outside", hits, 1, listings, 0);
+
+	/* a workspace of monitor 3 moves to monitor 1 and is focused there: it
+	 * is not in monitor 1's listing, which is fetched again and ends with
+	 * it, so next wraps round to the first */
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	char moved[32];
+	snprintf(moved, sizeof(moved), "%s", name_of(MOCK_WORKSPACES - 1));
+	run_outside((const char*[]) { "move-workspace-to-monitor", "--workspace", moved, "1" }, 4);
+	run_outside((const char*[]) { "workspace", moved }, 2);
+	swipe(client, &config, next, 1);
+	expect_focus("workspace moved here", 0, 1);
+	expect_counts("workspace moved here", hits, 0, listings, 1);
+
+	/* forgotten, as on a display change */
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	executor_forget_workspaces();
+	swipe(client, &config, next, 1);
+	expect_focus("forgotten", 1, 1);
+	expect_counts("forgotten", hits, 0, listings, 1);
+
+	/* skip_empty lists the focused monitor every time */
+	config.skip_empty = true;
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	double listed = swipe(client, &config, next, SWIPES);
+	expect_focus("listed swipes", (1 + SWIPES) % (PER_MONITOR + 1), 1);
+	expect_counts("listed swipes", hits, 0, listings, SWIPES);
+
+	/* the daemon's own command moves the next workspace away: the cache
+	 * is dropped rather than swiping onto it on the other monitor */
+	config.skip_empty = false;
+	swipe(client, &config, next, 1);
+	Binding moving = { .label = "move-workspace-to-monitor" };
+	if (!aerospace_request_build(&moving.request,
+		    (const char*[]) { "move-workspace-to-monitor", "--workspace", name_of(94), "2" }, 4)) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	execute_binding(client, NULL, &config, &moving, stats_now_ns());
+	aerospace_request_free(&moving.request);
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	swipe(client, &config, next, 1);
+	expect_focus("daemon's own command", 95, 1);
+	expect_counts("daemon's own command", hits, 0, listings, 1);
+
+	/* the same from outside goes unseen until the listing ages out */
+	run_outside((const char*[]) { "move-workspace-to-monitor", "--workspace", name_of(96), "2" }, 4);
+	struct timespec aged = { 1, 50000000 }; /* past WORKSPACE_CACHE_MAX_AGE_NS */
+	nanosleep(&aged, NULL);
+	hits = counter("workspace_hits"), listings = counter("workspace_listings");
+	swipe(client, &config, next, 1);
+	expect_focus("aged out", 97, 1);
+	expect_counts("aged out", hits, 0, listings, 1);
+
+	printf("%d workspaces on %d monitors: cached %6.1f us/swipe  listed every swipe %6.1f us/swipe  %s\n",
+		MOCK_WORKSPACES, MOCK_MONITORS, cached * 1e6, listed * 1e6, failures ? "MISMATCH" : "");
+	aerospace_close(client);
+	aerospace_close(outside);
+	config_free(&config);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include "../src/workspace_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 2000
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A list-workspaces reply for count workspaces with focused marked. */
+static char* reply(int count, int focused, size_t* len)
+{
+	char* out = malloc((size_t)count * 32 + 1);
+	size_t at = 0;
+	for (int i = 0; i < count; ++i)
+		at += sprintf(out + at, "ws-%d\t%s\n", i + 1, i == focused ? "true" : "false");
+	*len = at;
+	return out;
+}
+
+/* Swipes right through count workspaces the way the executor sees them: a
+ * fresh reply with the focus moved, parsed, then one step. Every step is
+ * checked against the name it must land on; lookups are checked by name. */
+static int run(int count)
+{
+	workspace_table table;
+	workspace_table_init(&table);
+	size_t* lens = malloc(sizeof(size_t) * count);
+	char** replies = malloc(sizeof(char*) * count);
+	for (int i = 0; i < count; ++i)
+		replies[i] = reply(count, i, &lens[i]);
+
+	int mismatches = 0;
+	double start = now_seconds();
+	for (int r = 0; r < ROUNDS; ++r) {
+		int at = r % count;
+		if (!workspace_table_parse(&table, replies[at], lens[at]))
+			mismatches++;
+		int to = workspace_table_step(&table, 1, true);
+		char expected[32];
+		snprintf(expected, sizeof(expected), "ws-%d", (at + 1) % count + 1);
+		if (to < 0 || strcmp(workspace_table_name(&table, to), expected) != 0)
+			mismatches++;
+	}
+	double parse = (now_seconds() - start) / ROUNDS;
+
+	volatile int sink = 0;
+	start = now_seconds();
+	for (int r = 0; r < ROUNDS * 100; ++r)
+		sink += workspace_table_step(&table, r % 7 - 3, true);
+	double step = (now_seconds() - start) / (ROUNDS * 100);
+
+	char name[32];
+	start = now_seconds();
+	for (int r = 0; r < ROUNDS * 100; ++r) {
+		int i = r % count;
+		snprintf(name, sizeof(name), "ws-%d", i + 1);
+		mismatches += workspace_table_find(&table, name) != i;
+	}
+	double find = (now_seconds() - start) / (ROUNDS * 100);
+	(void)sink;
+
+	int ok = mismatches == 0 && table.rebuilds == 1;
+	printf("%5d workspaces: parse %8.0f ns (%5.1f ns/line)  step %5.1f ns  find+format %5.1f ns  rebuilds %llu  %s\n",
+		count, parse * 1e9, parse * 1e9 / count, step * 1e9, find * 1e9, (unsigned long long)table.rebuilds,
+		ok ? "" : "MISMATCH");
+
+	for (int i = 0; i < count; ++i)
+		free(replies[i]);
+	free(replies);
+	free(lens);
+	workspace_table_free(&table);
+	return ok;
+}
+
+int main(void)
+{
+	int ok = 1;
+	ok = run(10) && ok;
+	ok = run(100) && ok;
+	ok = run(1000) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "../src/cJSON.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Fuzz target for the vendored cJSON. Parses the input both as a sized and as
+ * a terminated buffer, then checks that every printer agrees with the
+ * measuring pass. Built against libFuzzer by default; with
+ * -DFUZZ_STANDALONE it reads inputs from files or stdin for AFL and corpus
+ * replay. */
+
+static void check_printers(cJSON* json)
+{
+	for (int format = 0; format < 2; ++format) {
+		char* printed = format ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+		if (!printed)
+			continue;
+
+		size_t len = strlen(printed);
+		if (cJSON_PrintLength(json, format) != len)
+			abort();
+
+		char* prealloc = malloc(len + 2);
+		if (!prealloc)
+			abort();
+		if (!cJSON_PrintPreallocated(json, prealloc, (int)len + 2, format) || strcmp(prealloc, printed) != 0)
+			abort();
+		free(prealloc);
+
+		char* buffered = cJSON_PrintBuffered(json, 1, format);
+		if (!buffered || strcmp(buffered, printed) != 0)
+			abort();
+		cJSON_free(buffered);
+
+		cJSON* reparsed = cJSON_Parse(printed);
+		if (!reparsed)
+			abort();
+		cJSON_Delete(reparsed);
+
+		cJSON_free(printed);
+	}
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	const char* end = NULL;
+	cJSON* json = cJSON_ParseWithLengthOpts((const char*)data, size, &end, 0);
+	if (json) {
+		check_printers(json);
+		cJSON_Delete(json);
+	}
+
+	/* the terminated variants walk the same code with different bounds */
+	char* terminated = malloc(size + 1);
+	if (!terminated)
+		return 0;
+	memcpy(terminated, data, size);
+	terminated[size] = '\0';
+
+	json = cJSON_ParseWithOpts(terminated, &end, 1);
+	if (json) {
+		check_printers(json);
+		cJSON_Delete(json);
+	}
+
+	cJSON_Minify(terminated);
+	free(terminated);
+	return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+static int run_stream(FILE* file)
+{
+	size_t cap = 4096, len = 0;
+	uint8_t* buf = malloc(cap);
+	if (!buf)
+		return 1;
+
+	size_t n;
+	while ((n = fread(buf + len, 1, cap - len, file)) > 0) {
+		len += n;
+		if (len == cap) {
+			uint8_t* grown = realloc(buf, cap * 2);
+			if (!grown) {
+				free(buf);
+				return 1;
+			}
+			buf = grown;
+			cap *= 2;
+		}
+	}
+
+	LLVMFuzzerTestOneInput(buf, len);
+	free(buf);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+		return run_stream(stdin);
+
+	for (int i = 1; i < argc; ++i) {
+		FILE* file = fopen(argv[i], "rb");
+		if (!file) {
+			fprintf(stderr, "%s: could not open file\n", argv[i]);
+			return 1;
+		}
+		int rc = run_stream(file);
+		fclose(file);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+#endif
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -6,14 +7,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "aerospace.h"
 #include "cJSON.h"
+#include "log.h"
+#include "stats.h"
+#include "trace.h"
+#include "workspace_table.h"
 
 #define DEFAULT_MAX_BUFFER_SIZE 2048
 #define DEFAULT_EXTENDED_BUFFER_SIZE 4096
+/* background connect: first retry after this, doubling up to the max */
+#define CONNECT_RETRY_FIRST_MS 25
+#define CONNECT_RETRY_MAX_MS 1000
 
 static const char* ERROR_SOCKET_CREATE = "Failed to create Unix domain socket";
 static const char* ERROR_SOCKET_CONNECT_FMT = "Failed to connect to socket at %s";
@@ -26,10 +36,20 @@ static const char* ERROR_JSON_DECODE = "Failed to decode JSON response";
 struct Aerospace {
 	int fd;
 	char* socket_path;
+	char* send_buf;
+	size_t send_cap;
+	char* recv_buf;
+	size_t recv_cap;
+	/* list-workspaces requests for the focused monitor, [0] all and [1]
+	 * non-empty only, and [2] for the focused workspace alone */
+	aerospace_request list_requests[3];
 };
 
 static void fatal_error(const char* fmt, ...)
 {
+	/* buffered log lines would otherwise be lost, and they explain the exit */
+	log_flush();
+
 	va_list args;
 	va_start(args, fmt);
 	vfprintf(stderr, fmt, args);
@@ -53,46 +73,176 @@ static ssize_t write_all(int fd, const char* buf, size_t count)
 	return total_written;
 }
 
-static cJSON* decode_response(const char* response)
+static ssize_t writev_all(int fd, struct iovec* iov, int iovcnt)
 {
-	cJSON* json = cJSON_Parse(response);
-	if (!json)
-		fprintf(stderr, "%s: %s\n", ERROR_JSON_DECODE, cJSON_GetErrorPtr());
-	return json;
+	size_t total_written = 0;
+	while (iovcnt > 0) {
+		ssize_t written = writev(fd, iov, iovcnt);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		total_written += written;
+		while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char*)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return total_written;
 }
 
-static cJSON* perform_query(Aerospace* client, cJSON* query)
+static void reserve_send_buf(Aerospace* client, size_t size)
 {
-	aerospace_send(client, query);
-	/* The query object is deleted inside perform_query (via aerospace_send call)
-	 */
-	char* response_str = aerospace_receive(client, DEFAULT_MAX_BUFFER_SIZE);
-	cJSON* response_json = decode_response(response_str);
-	free(response_str);
-	return response_json;
+	if (client->send_cap >= size)
+		return;
+	char* grown = realloc(client->send_buf, size);
+	if (!grown)
+		fatal_error("Memory allocation error");
+	client->send_buf = grown;
+	client->send_cap = size;
 }
 
-static char* execute_workspace_command(Aerospace* client, const char* cmd,
-	int wrap, const char* stdin_value)
+/* JSON-escape value into the client's send buffer, returning its length */
+static size_t escape_into_send_buf(Aerospace* client, const char* value)
 {
-	cJSON* query = cJSON_CreateObject();
-	if (!query)
-		fatal_error("Memory allocation error");
+	static const char hex[] = "0123456789abcdef";
+	size_t len = strlen(value);
+	/* worst case every byte becomes \u00XX */
+	reserve_send_buf(client, len * 6 + 1);
+
+	char* out = client->send_buf;
+	for (const unsigned char* p = (const unsigned char*)value; *p; ++p) {
+		switch (*p) {
+		case '\"':
+			*out++ = '\\';
+			*out++ = '\"';
+			break;
+		case '\\':
+			*out++ = '\\';
+			*out++ = '\\';
+			break;
+		case '\n':
+			*out++ = '\\';
+			*out++ = 'n';
+			break;
+		case '\t':
+			*out++ = '\\';
+			*out++ = 't';
+			break;
+		case '\r':
+			*out++ = '\\';
+			*out++ = 'r';
+			break;
+		default:
+			if (*p < 32) {
+				*out++ = '\\';
+				*out++ = 'u';
+				*out++ = '0';
+				*out++ = '0';
+				*out++ = hex[*p >> 4];
+				*out++ = hex[*p & 0xf];
+			} else {
+				*out++ = *p;
+			}
+			break;
+		}
+	}
+	return out - client->send_buf;
+}
 
-	cJSON_AddStringToObject(query, "command", "");
-	cJSON* args = cJSON_CreateArray();
-	if (!args) {
-		cJSON_Delete(query);
-		fatal_error("Memory allocation error");
+static void send_request(Aerospace* client, const aerospace_request* req,
+	const char* stdin_value)
+{
+	if (!aerospace_is_initialized(client))
+		fatal_error("%s", ERROR_SOCKET_NOT_CONN);
+
+	uint64_t span = trace_begin();
+	ssize_t bytes_sent;
+	if (!stdin_value || !*stdin_value) {
+		bytes_sent = write_all(client->fd, req->data, req->len);
+	} else {
+		size_t escaped_len = escape_into_send_buf(client, stdin_value);
+		struct iovec iov[3] = {
+			{ req->data, req->stdin_at },
+			{ client->send_buf, escaped_len },
+			{ req->data + req->stdin_at, req->len - req->stdin_at },
+		};
+		bytes_sent = writev_all(client->fd, iov, 3);
 	}
-	cJSON_AddItemToArray(args, cJSON_CreateString("workspace"));
-	cJSON_AddItemToArray(args, cJSON_CreateString(cmd));
-	if (wrap)
-		cJSON_AddItemToArray(args, cJSON_CreateString("--wrap-around"));
-	cJSON_AddItemToObject(query, "args", args);
-	cJSON_AddStringToObject(query, "stdin", stdin_value);
-
-	cJSON* response_json = perform_query(client, query);
+	if (bytes_sent < 0)
+		fatal_error("%s: %s", ERROR_SOCKET_SEND, strerror(errno));
+	trace_end("aerospace_send", span);
+}
+
+/* One reply, read until its outermost JSON object closes: a listing of
+ * hundreds of workspaces does not come in one read. Returns the client's
+ * receive buffer, NUL-terminated and valid until the next request. */
+static const char* receive_response(Aerospace* client)
+{
+	if (!aerospace_is_initialized(client))
+		fatal_error("%s", ERROR_SOCKET_NOT_CONN);
+
+	uint64_t span = trace_begin();
+	size_t len = 0;
+	int depth = 0;
+	bool in_string = false, escaped = false, complete = false;
+	while (!complete) {
+		if (client->recv_cap < len + DEFAULT_MAX_BUFFER_SIZE + 1) {
+			size_t cap = client->recv_cap ? client->recv_cap * 2 : DEFAULT_EXTENDED_BUFFER_SIZE;
+			while (cap < len + DEFAULT_MAX_BUFFER_SIZE + 1)
+				cap *= 2;
+			char* grown = realloc(client->recv_buf, cap);
+			if (!grown)
+				fatal_error("Memory allocation error");
+			client->recv_buf = grown;
+			client->recv_cap = cap;
+		}
+		ssize_t n = read(client->fd, client->recv_buf + len, client->recv_cap - len - 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			fatal_error("%s: %s", ERROR_SOCKET_RECEIVE, strerror(errno));
+		if (n == 0)
+			break;
+
+		for (const char* p = client->recv_buf + len; p < client->recv_buf + len + n; ++p) {
+			if (escaped)
+				escaped = false;
+			else if (in_string && *p == '\\')
+				escaped = true;
+			else if (in_string)
+				in_string = *p != '"';
+			else if (*p == '"')
+				in_string = true;
+			else if (*p == '{' || *p == '[')
+				depth++;
+			else if ((*p == '}' || *p == ']') && --depth == 0)
+				complete = true;
+		}
+		len += n;
+	}
+	client->recv_buf[len] = '\0';
+	trace_end("aerospace_receive", span);
+	return client->recv_buf;
+}
+
+static cJSON* decode_response(const char* response)
+{
+	cJSON* json = cJSON_Parse(response);
+	if (!json)
+		log_error("%s: %s", ERROR_JSON_DECODE, cJSON_GetErrorPtr());
+	return json;
+}
+
+/* NULL if the command succeeded, otherwise a copy of its stderr */
+static char* command_result(cJSON* response_json)
+{
 	if (!response_json)
 		return NULL;
 
@@ -104,7 +254,7 @@ static char* execute_workspace_command(Aerospace* client, const char* cmd,
 	} else {
 		cJSON* stderr_item = cJSON_GetObjectItem(response_json, "stderr");
 		if (!stderr_item || !cJSON_IsString(stderr_item)) {
-			fprintf(stderr, "Response does not contain valid stderr\n");
+			log_error("Response does not contain valid stderr");
 			cJSON_Delete(response_json);
 			return NULL;
 		}
@@ -147,7 +297,8 @@ static char* get_default_socket_path(void)
 	return path;
 }
 
-Aerospace* aerospace_new(const char* socketPath)
+/* Everything but the connection. */
+static Aerospace* client_alloc(const char* socketPath)
 {
 	Aerospace* client = malloc(sizeof(Aerospace));
 	if (!client)
@@ -160,11 +311,32 @@ Aerospace* aerospace_new(const char* socketPath)
 	} else {
 		client->socket_path = get_default_socket_path();
 	}
+	client->fd = -1;
+	client->send_buf = NULL;
+	client->send_cap = 0;
+	client->recv_buf = NULL;
+	client->recv_cap = 0;
+
+	static const char* const list_all[] = { "list-workspaces", "--monitor", "focused", "--format",
+		WORKSPACE_TABLE_FORMAT };
+	static const char* const list_non_empty[] = { "list-workspaces", "--monitor", "focused", "--empty", "no",
+		"--format", WORKSPACE_TABLE_FORMAT };
+	static const char* const list_focused[] = { "list-workspaces", "--focused", "--format", WORKSPACE_TABLE_FORMAT };
+	if (!aerospace_request_build(&client->list_requests[0], list_all, 5)
+		|| !aerospace_request_build(&client->list_requests[1], list_non_empty, 7)
+		|| !aerospace_request_build(&client->list_requests[2], list_focused, 4))
+		fatal_error("Memory allocation error");
+	return client;
+}
+
+/* NULL with errno set when the socket is not there or nobody listens. */
+static Aerospace* client_connect(const char* socketPath)
+{
+	Aerospace* client = client_alloc(socketPath);
 
 	client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
 	if (client->fd < 0) {
-		free(client->socket_path);
-		free(client);
+		aerospace_close(client);
 		fatal_error("%s: %s", ERROR_SOCKET_CREATE, strerror(errno));
 	}
 
@@ -174,65 +346,89 @@ Aerospace* aerospace_new(const char* socketPath)
 	strncpy(addr.sun_path, client->socket_path, sizeof(addr.sun_path) - 1);
 
 	if (connect(client->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-		char* used_path = strdup(client->socket_path);
-		close(client->fd);
-		free(client->socket_path);
-		free(client);
-		fatal_error(ERROR_SOCKET_CONNECT_FMT, used_path);
+		int error = errno;
+		aerospace_close(client);
+		errno = error;
+		return NULL;
 	}
-
 	return client;
 }
 
-int aerospace_is_initialized(Aerospace* client)
+Aerospace* aerospace_new(const char* socketPath)
 {
-	return (client && client->fd >= 0);
+	Aerospace* client = client_connect(socketPath);
+	if (!client) {
+		char* used_path = socketPath ? strdup(socketPath) : get_default_socket_path();
+		fatal_error(ERROR_SOCKET_CONNECT_FMT, used_path);
+	}
+	return client;
 }
 
-ssize_t aerospace_send(Aerospace* client, cJSON* query)
-{
-	if (!aerospace_is_initialized(client))
-		fatal_error("%s", ERROR_SOCKET_NOT_CONN);
+typedef struct {
+	char* socket_path;
+	void (*connected)(Aerospace* client);
+} connect_job;
 
-	char* json_str = cJSON_PrintUnformatted(query);
-	if (!json_str)
-		fatal_error("%s", ERROR_JSON_DECODE);
+static void* connect_thread(void* arg)
+{
+	connect_job* job = arg;
+	uint64_t delay_ms = CONNECT_RETRY_FIRST_MS;
+	int attempts = 1;
+	Aerospace* client;
+	while (!(client = client_connect(job->socket_path))) {
+		if (attempts == 1)
+			log_warn("Aerospace is not listening yet (%s), retrying in the background.", strerror(errno));
+		struct timespec ts = { (time_t)(delay_ms / 1000), (long)(delay_ms % 1000) * 1000000L };
+		nanosleep(&ts, NULL);
+		stats_count(COUNTER_RECONNECTS);
+		delay_ms = delay_ms * 2 < CONNECT_RETRY_MAX_MS ? delay_ms * 2 : CONNECT_RETRY_MAX_MS;
+		attempts++;
+	}
+	if (attempts > 1)
+		log_info("Connected to aerospace after %d attempts.", attempts);
+	job->connected(client);
+	free(job->socket_path);
+	free(job);
+	return NULL;
+}
 
-	size_t len = strlen(json_str);
-	size_t total_len = len + 1;
-	char* send_buf = malloc(total_len + 1);
-	if (!send_buf) {
-		free(json_str);
-		fatal_error("Memory allocation error");
+bool aerospace_connect_async(const char* socketPath, void (*connected)(Aerospace* client))
+{
+	connect_job* job = malloc(sizeof(connect_job));
+	if (!job)
+		return false;
+	job->socket_path = socketPath ? strdup(socketPath) : NULL;
+	job->connected = connected;
+	if (socketPath && !job->socket_path) {
+		free(job);
+		return false;
 	}
-	snprintf(send_buf, total_len + 1, "%s\n", json_str);
-	free(json_str);
 
-	ssize_t bytes_sent = write_all(client->fd, send_buf, total_len);
-	if (bytes_sent < 0) {
-		free(send_buf);
-		fatal_error("%s: %s", ERROR_SOCKET_SEND, strerror(errno));
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, connect_thread, job) != 0) {
+		free(job->socket_path);
+		free(job);
+		return false;
 	}
-	free(send_buf);
-	return bytes_sent;
+	pthread_detach(thread);
+	return true;
 }
 
-char* aerospace_receive(Aerospace* client, size_t maxBytes)
+Aerospace* aerospace_adopt(int fd, const char* socketPath)
 {
-	if (!aerospace_is_initialized(client))
-		fatal_error("%s", ERROR_SOCKET_NOT_CONN);
+	Aerospace* client = client_alloc(socketPath);
+	client->fd = fd;
+	return client;
+}
 
-	char* buffer = malloc(maxBytes + 1);
-	if (!buffer)
-		fatal_error("Memory allocation error");
+int aerospace_fd(Aerospace* client)
+{
+	return client ? client->fd : -1;
+}
 
-	ssize_t bytes_read = read(client->fd, buffer, maxBytes);
-	if (bytes_read < 0) {
-		free(buffer);
-		fatal_error("%s: %s", ERROR_SOCKET_RECEIVE, strerror(errno));
-	}
-	buffer[bytes_read] = '\0';
-	return buffer;
+int aerospace_is_initialized(Aerospace* client)
+{
+	return (client && client->fd >= 0);
 }
 
 void aerospace_close(Aerospace* client)
@@ -240,58 +436,140 @@ void aerospace_close(Aerospace* client)
 	if (client) {
 		if (client->fd >= 0) {
 			if (close(client->fd) < 0)
-				fprintf(stderr, "%s: %s\n", ERROR_SOCKET_CLOSE, strerror(errno));
+				log_error("%s: %s", ERROR_SOCKET_CLOSE, strerror(errno));
 			client->fd = -1;
 		}
 		free(client->socket_path);
+		free(client->send_buf);
+		free(client->recv_buf);
+		for (int i = 0; i < 3; ++i)
+			aerospace_request_free(&client->list_requests[i]);
 		free(client);
 	}
 }
 
-char* aerospace_switch(Aerospace* client, const char* direction)
+static bool list_into(Aerospace* client, const aerospace_request* req, workspace_table* table)
+{
+	send_request(client, req, NULL);
+	cJSON* response_json = decode_response(receive_response(client));
+
+	bool listed = false;
+	cJSON* stdout_item = cJSON_GetObjectItem(response_json, "stdout");
+	if (response_json && (!stdout_item || !cJSON_IsString(stdout_item)))
+		log_error("Response does not contain valid stdout");
+	else if (stdout_item)
+		listed = workspace_table_parse(table, stdout_item->valuestring, strlen(stdout_item->valuestring));
+	cJSON_Delete(response_json);
+	return listed;
+}
+
+bool aerospace_list_workspaces(Aerospace* client, int monitor, bool empty, workspace_table* table)
+{
+	uint64_t span = trace_begin();
+	bool listed;
+	if (monitor == WORKSPACES_FOCUSED_MONITOR) {
+		listed = list_into(client, &client->list_requests[empty ? 1 : 0], table);
+	} else {
+		/* a refresh of one monitor's cached listing, rare enough to build */
+		char id[16];
+		snprintf(id, sizeof(id), "%d", monitor);
+		const char* args[] = { "list-workspaces", "--monitor", id, "--format", WORKSPACE_TABLE_FORMAT, "--empty",
+			"no" };
+		aerospace_request req;
+		if (!aerospace_request_build(&req, args, empty ? 7 : 5))
+			fatal_error("Memory allocation error");
+		listed = list_into(client, &req, table);
+		aerospace_request_free(&req);
+	}
+	trace_end("aerospace_list_workspaces", span);
+	return listed;
+}
+
+bool aerospace_focused_workspace(Aerospace* client, workspace_table* table)
 {
-	return execute_workspace_command(client, direction, 0, "");
+	uint64_t span = trace_begin();
+	bool listed = list_into(client, &client->list_requests[2], table) && table->count == 1;
+	trace_end("aerospace_focused_workspace", span);
+	return listed;
 }
 
-char* aerospace_workspace(Aerospace* client, int wrap, const char* ws,
-	const char* in)
+char* aerospace_focus_workspace(Aerospace* client, const char* name)
 {
-	return execute_workspace_command(client, ws, wrap, in);
+	/* the same JSON aerospace_request_build makes for "workspace <name>",
+	 * with the name escaped in between */
+	static const char prefix[] = "{\"command\":\"\",\"args\":[\"workspace\",\"";
+	static const char suffix[] = "\"],\"stdin\":\"\"}\n";
+	if (!aerospace_is_initialized(client))
+		fatal_error("%s", ERROR_SOCKET_NOT_CONN);
+
+	uint64_t span = trace_begin();
+	size_t escaped_len = escape_into_send_buf(client, name);
+	struct iovec iov[3] = {
+		{ (void*)prefix, sizeof(prefix) - 1 },
+		{ client->send_buf, escaped_len },
+		{ (void*)suffix, sizeof(suffix) - 1 },
+	};
+	if (writev_all(client->fd, iov, 3) < 0)
+		fatal_error("%s: %s", ERROR_SOCKET_SEND, strerror(errno));
+
+	char* result = command_result(decode_response(receive_response(client)));
+	trace_end("aerospace_focus_workspace", span);
+	return result;
 }
 
-char* aerospace_list_workspaces(Aerospace* client, bool empty)
+bool aerospace_request_build(aerospace_request* req, const char* const* args,
+	int argc)
 {
+	req->data = NULL;
+	req->len = 0;
+	req->stdin_at = 0;
+
 	cJSON* query = cJSON_CreateObject();
-	if (!query)
-		fatal_error("Memory allocation error");
+	cJSON* array = cJSON_CreateArray();
+	if (!query || !array) {
+		cJSON_Delete(query);
+		cJSON_Delete(array);
+		return false;
+	}
 
 	cJSON_AddStringToObject(query, "command", "");
-	cJSON* args = cJSON_CreateArray();
-	if (!args) {
+	for (int i = 0; i < argc; ++i)
+		cJSON_AddItemToArray(array, cJSON_CreateString(args[i]));
+	cJSON_AddItemToObject(query, "args", array);
+	/* stdin goes last so the splice point sits just before the closing "} */
+	cJSON_AddStringToObject(query, "stdin", "");
+
+	size_t len = cJSON_PrintLength(query, false);
+	char* data = len ? malloc(len + 2) : NULL;
+	if (!data || !cJSON_PrintPreallocated(query, data, (int)len + 2, false)) {
+		free(data);
 		cJSON_Delete(query);
-		fatal_error("Memory allocation error");
-	}
-	cJSON_AddItemToArray(args, cJSON_CreateString("list-workspaces"));
-	cJSON_AddItemToArray(args, cJSON_CreateString("--monitor"));
-	cJSON_AddItemToArray(args, cJSON_CreateString("focused"));
-	if (empty) {
-		cJSON_AddItemToArray(args, cJSON_CreateString("--empty"));
-		cJSON_AddItemToArray(args, cJSON_CreateString("no"));
+		return false;
 	}
-	cJSON_AddItemToObject(query, "args", args);
-	cJSON_AddStringToObject(query, "stdin", "");
+	cJSON_Delete(query);
+
+	data[len] = '\n';
+	data[len + 1] = '\0';
+	req->data = data;
+	req->len = len + 1;
+	req->stdin_at = len - 2;
+	return true;
+}
 
-	cJSON* response_json = perform_query(client, query);
-	if (!response_json)
-		return NULL;
+void aerospace_request_free(aerospace_request* req)
+{
+	free(req->data);
+	req->data = NULL;
+	req->len = 0;
+	req->stdin_at = 0;
+}
 
-	cJSON* stdout_item = cJSON_GetObjectItem(response_json, "stdout");
-	if (!stdout_item || !cJSON_IsString(stdout_item)) {
-		fprintf(stderr, "Response does not contain valid stdout\n");
-		cJSON_Delete(response_json);
-		return NULL;
-	}
-	char* result = strdup(stdout_item->valuestring);
-	cJSON_Delete(response_json);
+char* aerospace_execute(Aerospace* client, const aerospace_request* req,
+	const char* stdin_value)
+{
+	uint64_t span = trace_begin();
+	send_request(client, req, stdin_value);
+	char* result = command_result(decode_response(receive_response(client)));
+	trace_end("aerospace_execute", span);
 	return result;
 }
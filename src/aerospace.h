@@ -1,25 +1,64 @@
+#ifndef AEROSPACE_H
 #define AEROSPACE_H
 
 #include "cJSON.h"
+#include "workspace_table.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <sys/types.h>
 
 typedef struct Aerospace Aerospace;
 
+/* A request serialized once ahead of time, newline included. stdin_at is the
+ * offset between the quotes of its empty "stdin" value, so a workspace list
+ * can be spliced in at send time without rebuilding any JSON. */
+typedef struct {
+	char* data;
+	size_t len;
+	size_t stdin_at;
+} aerospace_request;
+
+bool aerospace_request_build(aerospace_request* req, const char* const* args,
+	int argc);
+
+void aerospace_request_free(aerospace_request* req);
+
+/* Exits when aerospace is not listening. */
 Aerospace* aerospace_new(const char* socketPath);
 
-int aerospace_is_initialized(Aerospace* client);
+/* Connect on a background thread, retrying with backoff for as long as
+ * aerospace is not listening, as at login when both start together, and
+ * hand the client to connected on that thread. socketPath may be NULL for
+ * the default. */
+bool aerospace_connect_async(const char* socketPath, void (*connected)(Aerospace* client));
 
-ssize_t aerospace_send(Aerospace* client, cJSON* query);
+/* A client on an already connected fd, e.g. one handed over by a previous
+ * instance; it takes ownership of fd. */
+Aerospace* aerospace_adopt(int fd, const char* socketPath);
 
-char* aerospace_receive(Aerospace* client, size_t maxBytes);
+/* The connection's fd, -1 when there is none. Still owned by the client. */
+int aerospace_fd(Aerospace* client);
+
+int aerospace_is_initialized(Aerospace* client);
 
 void aerospace_close(Aerospace* client);
 
-char* aerospace_switch(Aerospace* client, const char* direction);
+#define WORKSPACES_FOCUSED_MONITOR -1
+
+/* A monitor's workspaces, by aerospace's monitor id or
+ * WORKSPACES_FOCUSED_MONITOR, all of them or with empty set the non-empty
+ * ones only, parsed into table. False when the reply is unusable. */
+bool aerospace_list_workspaces(Aerospace* client, int monitor, bool empty, workspace_table* table);
+
+/* The focused workspace alone, with its monitor: a one line table. */
+bool aerospace_focused_workspace(Aerospace* client, workspace_table* table);
+
+/* "workspace <name>", NULL on success like aerospace_execute. */
+char* aerospace_focus_workspace(Aerospace* client, const char* name);
 
-char* aerospace_workspace(Aerospace* client, int wrap, const char* ws,
-	const char* in);
+/* Send a prebuilt request, with stdin_value (may be NULL) spliced in. Returns
+ * NULL on success or the command's stderr on failure. */
+char* aerospace_execute(Aerospace* client, const aerospace_request* req,
+	const char* stdin_value);
 
-char* aerospace_list_workspaces(Aerospace* client, bool empty);
+#endif
@@ -508,24 +508,15 @@ static cJSON_bool compare_double(double a, double b)
 	return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
-/* Render the number nicely from the given item into a string. */
-static cJSON_bool print_number(const cJSON* const item,
-	printbuffer* const output_buffer)
+/* Render the number of an item into number_buffer, without touching the
+ * locale dependent decimal point. Returns the length, or -1 on failure. */
+static int format_number(const cJSON* const item,
+	unsigned char number_buffer[26])
 {
-	unsigned char* output_pointer = NULL;
 	double d = item->valuedouble;
 	int length = 0;
-	size_t i = 0;
-	unsigned char number_buffer[26] = {
-		0
-	}; /* temporary buffer to print the number into */
-	unsigned char decimal_point = get_decimal_point();
 	double test = 0.0;
 
-	if (output_buffer == NULL) {
-		return false;
-	}
-
 	/* This checks for NaN and Infinity */
 	if (isnan(d) || isinf(d)) {
 		length = sprintf((char*)number_buffer, "null");
@@ -544,7 +535,31 @@ static cJSON_bool print_number(const cJSON* const item,
 	}
 
 	/* sprintf failed or buffer overrun occurred */
-	if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1))) {
+	if ((length < 0) || (length > 25)) {
+		return -1;
+	}
+
+	return length;
+}
+
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON* const item,
+	printbuffer* const output_buffer)
+{
+	unsigned char* output_pointer = NULL;
+	int length = 0;
+	size_t i = 0;
+	unsigned char number_buffer[26] = {
+		0
+	}; /* temporary buffer to print the number into */
+	unsigned char decimal_point = get_decimal_point();
+
+	if (output_buffer == NULL) {
+		return false;
+	}
+
+	length = format_number(item, number_buffer);
+	if (length < 0) {
 		return false;
 	}
 
@@ -820,6 +835,40 @@ fail:
 	return false;
 }
 
+/* Length of the escaped form of a cstring, without the surrounding quotes.
+ * The number of additional characters needed for escaping is stored in
+ * escape_characters. */
+static size_t escaped_string_length(const unsigned char* const input,
+	size_t* const escape_characters)
+{
+	const unsigned char* input_pointer = NULL;
+	size_t escapes = 0;
+
+	for (input_pointer = input; *input_pointer; input_pointer++) {
+		switch (*input_pointer) {
+		case '\"':
+		case '\\':
+		case '\b':
+		case '\f':
+		case '\n':
+		case '\r':
+		case '\t':
+			/* one character escape sequence */
+			escapes++;
+			break;
+		default:
+			if (*input_pointer < 32) {
+				/* UTF-16 escape sequence uXXXX */
+				escapes += 5;
+			}
+			break;
+		}
+	}
+
+	*escape_characters = escapes;
+	return (size_t)(input_pointer - input) + escapes;
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char* const input,
 	printbuffer* const output_buffer)
@@ -846,28 +895,7 @@ static cJSON_bool print_string_ptr(const unsigned char* const input,
 		return true;
 	}
 
-	/* set "flag" to 1 if something needs to be escaped */
-	for (input_pointer = input; *input_pointer; input_pointer++) {
-		switch (*input_pointer) {
-		case '\"':
-		case '\\':
-		case '\b':
-		case '\f':
-		case '\n':
-		case '\r':
-		case '\t':
-			/* one character escape sequence */
-			escape_characters++;
-			break;
-		default:
-			if (*input_pointer < 32) {
-				/* UTF-16 escape sequence uXXXX */
-				escape_characters += 5;
-			}
-			break;
-		}
-	}
-	output_length = (size_t)(input_pointer - input) + escape_characters;
+	output_length = escaped_string_length(input, &escape_characters);
 
 	output = ensure(output_buffer, output_length + sizeof("\"\""));
 	if (output == NULL) {
@@ -1092,63 +1120,142 @@ cJSON_ParseWithLength(const char* value, size_t buffer_length)
 
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
+/* Extra bytes past the terminator that the ensure() calls of the printers
+ * reserve in the worst case. A buffer of measured length + 1 + this never
+ * needs to grow. */
+#define PRINT_SLACK 1
+
+/* Compute the exact number of characters print_value would produce for item,
+ * without writing anything. Mirrors print_value/print_array/print_object. */
+static cJSON_bool measure_value(const cJSON* const item, cJSON_bool format,
+	size_t depth, size_t* const length)
+{
+	unsigned char number_buffer[26];
+	size_t escape_characters = 0;
+	size_t total = 0;
+	const cJSON* current = NULL;
+	int number_length = 0;
+
+	if (item == NULL) {
+		return false;
+	}
+
+	switch ((item->type) & 0xFF) {
+	case cJSON_NULL:
+		*length = static_strlen("null");
+		return true;
+
+	case cJSON_False:
+		*length = static_strlen("false");
+		return true;
+
+	case cJSON_True:
+		*length = static_strlen("true");
+		return true;
+
+	case cJSON_Number:
+		number_length = format_number(item, number_buffer);
+		if (number_length < 0) {
+			return false;
+		}
+		*length = (size_t)number_length;
+		return true;
+
+	case cJSON_Raw:
+		if (item->valuestring == NULL) {
+			return false;
+		}
+		*length = strlen(item->valuestring);
+		return true;
+
+	case cJSON_String:
+		*length = (item->valuestring == NULL)
+			? static_strlen("\"\"")
+			: escaped_string_length((const unsigned char*)item->valuestring, &escape_characters) + static_strlen("\"\"");
+		return true;
+
+	case cJSON_Array:
+		total = static_strlen("[]");
+		for (current = item->child; current != NULL; current = current->next) {
+			size_t element = 0;
+			if (!measure_value(current, format, depth + 1, &element)) {
+				return false;
+			}
+			total += element;
+			if (current->next) {
+				total += format ? 2 : 1;
+			}
+		}
+		*length = total;
+		return true;
+
+	case cJSON_Object:
+		/* "{" "}" plus, when formatted, "\n" and the closing indentation */
+		total = format ? (3 + depth) : 2;
+		for (current = item->child; current != NULL; current = current->next) {
+			size_t value = 0;
+			if (!measure_value(current, format, depth + 1, &value)) {
+				return false;
+			}
+			total += value;
+			total += (current->string == NULL)
+				? static_strlen("\"\"")
+				: escaped_string_length((const unsigned char*)current->string, &escape_characters) + static_strlen("\"\"");
+			/* indentation, ':' (+ '\t'), ',' and '\n' */
+			total += format ? (depth + 1 + 2 + 1) : 1;
+			if (current->next) {
+				total++;
+			}
+		}
+		*length = total;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 static unsigned char* print(const cJSON* const item, cJSON_bool format,
 	const internal_hooks* const hooks)
 {
-	static const size_t default_buffer_size = 256;
 	printbuffer buffer[1];
-	unsigned char* printed = NULL;
+	size_t length = 0;
 
 	memset(buffer, 0, sizeof(buffer));
 
-	/* create buffer */
-	buffer->buffer = (unsigned char*)hooks->allocate(default_buffer_size);
-	buffer->length = default_buffer_size;
+	/* measure first so that the output is allocated exactly once */
+	if (!measure_value(item, format, 0, &length) || (length > (INT_MAX - 2 - PRINT_SLACK))) {
+		return NULL;
+	}
+
+	buffer->length = length + 1 + PRINT_SLACK;
+	buffer->buffer = (unsigned char*)hooks->allocate(buffer->length);
+	buffer->noalloc = true;
 	buffer->format = format;
 	buffer->hooks = *hooks;
 	if (buffer->buffer == NULL) {
-		goto fail;
+		return NULL;
 	}
 
 	/* print the value */
 	if (!print_value(item, buffer)) {
-		goto fail;
-	}
-	update_offset(buffer);
-
-	/* check if reallocate is available */
-	if (hooks->reallocate != NULL) {
-		printed = (unsigned char*)hooks->reallocate(buffer->buffer, buffer->offset + 1);
-		if (printed == NULL) {
-			goto fail;
-		}
-		buffer->buffer = NULL;
-	} else /* otherwise copy the JSON over to a new buffer */
-	{
-		printed = (unsigned char*)hooks->allocate(buffer->offset + 1);
-		if (printed == NULL) {
-			goto fail;
-		}
-		memcpy(printed, buffer->buffer,
-			cjson_min(buffer->length, buffer->offset + 1));
-		printed[buffer->offset] = '\0'; /* just to be sure */
-
-		/* free the buffer */
 		hooks->deallocate(buffer->buffer);
+		return NULL;
 	}
 
-	return printed;
+	return buffer->buffer;
+}
 
-fail:
-	if (buffer->buffer != NULL) {
-		hooks->deallocate(buffer->buffer);
-	}
+CJSON_PUBLIC(size_t)
+cJSON_PrintLength(const cJSON* item, cJSON_bool format)
+{
+	size_t length = 0;
 
-	if (printed != NULL) {
-		hooks->deallocate(printed);
+	if (!measure_value(item, format, 0, &length)) {
+		return 0;
 	}
 
-	return NULL;
+	return length;
 }
 
 /* Render a cJSON item/entity/structure to text. */
@@ -188,10 +188,14 @@ cJSON_PrintUnformatted(const cJSON* item);
  * unformatted, =1 gives formatted */
 CJSON_PUBLIC(char*)
 cJSON_PrintBuffered(const cJSON* item, int prebuffer, cJSON_bool fmt);
+/* Compute the exact number of characters (without the terminator) that
+ * rendering item would produce. Returns 0 on failure. */
+CJSON_PUBLIC(size_t)
+cJSON_PrintLength(const cJSON* item, cJSON_bool format);
 /* Render a cJSON entity to text using a buffer already allocated in memory with
  * given length. Returns 1 on success and 0 on failure. */
-/* NOTE: cJSON is not always 100% accurate in estimating how much memory it will
- * use, so to be safe allocate 5 bytes more than you actually need */
+/* NOTE: a buffer of cJSON_PrintLength() + 2 bytes is always large enough, which
+ * lets a caller size (and reuse) its storage once instead of guessing. */
 CJSON_PUBLIC(cJSON_bool)
 cJSON_PrintPreallocated(cJSON* item, char* buffer, const int length,
 	const cJSON_bool format);
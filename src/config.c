@@ -0,0 +1,716 @@
+#include "config.h"
+#include "flight_recorder.h"
+#include <pthread.h>
+#include <pwd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* A published config and the readers pinning it. */
+typedef struct snapshot {
+	Config config; /* first, so a reader's Config* is its snapshot */
+	_Atomic int readers;
+	struct snapshot* next_retired;
+} snapshot;
+
+static _Atomic(snapshot*) current = NULL;
+/* readers between loading current and pinning what they loaded */
+static _Atomic int acquiring = 0;
+/* replaced snapshots not yet freed; guarded by reload_lock */
+static snapshot* retired = NULL;
+/* held from reading the file to publishing it, so reloads from the watcher
+ * and the control socket neither interleave nor publish out of order */
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* const direction_names[SWIPE_DIRECTIONS] = { "left", "right", "up", "down" };
+static const char* const modifier_names[MODIFIER_COUNT] = { "none", "shift", "control", "option", "command" };
+
+#define MAX_COMMAND_ARGS 16
+
+/* "fast" trades false positives for time to trigger, "conservative" the
+ * other way round; the first entry is the default */
+static const struct {
+	const char* name;
+	thresholds values;
+} threshold_profiles[] = {
+	{ "default", { 0.15f, 0.75f, 0.3f, 0.05f } },
+	{ "fast", { 0.12f, 0.6f, 0.2f, 0.05f } },
+	{ "conservative", { 0.16f, 1.2f, 0.4f, 0.05f } },
+};
+#define THRESHOLD_PROFILES (int)(sizeof(threshold_profiles) / sizeof(threshold_profiles[0]))
+
+static Config default_flags(void)
+{
+	Config config;
+	memset(&config, 0, sizeof(config));
+	config.natural_swipe = false;
+	config.wrap_around = true;
+	config.haptic = false;
+	config.haptic_policy = HAPTIC_ON_SWITCH;
+	config.skip_empty = true;
+	config.fingers = 3;
+	config.log_level = LOG_LEVEL_WARN;
+	for (int f = 0; f <= MAX_FINGERS; ++f)
+		config.thresholds[f] = threshold_profiles[0].values;
+	config.prediction.enabled = false;
+	config.prediction.horizon = 0.03f;
+	config.prediction.confidence = 0.95f;
+	return config;
+}
+
+static void free_binding(Binding* binding)
+{
+	aerospace_request_free(&binding->request);
+	free(binding->label);
+	binding->label = NULL;
+	binding->workspace_list = false;
+	binding->step = 0;
+	binding->wrap = false;
+}
+
+void config_free(Config* config)
+{
+	for (int f = 0; f <= MAX_FINGERS - MIN_FINGERS; ++f)
+		for (int d = 0; d < SWIPE_DIRECTIONS; ++d)
+			for (int m = 0; m < MODIFIER_COUNT; ++m)
+				free_binding(&config->bindings[f][d][m]);
+}
+
+/* Serialize one binding. "workspace next|prev" follows the global
+ * wrap_around/skip_empty options the same way the default bindings do. */
+static bool compile_binding(Config* config, int fingers, swipe_direction direction,
+	swipe_modifier modifier, const char** args, int argc)
+{
+	Binding* binding = &config->bindings[fingers - MIN_FINGERS][direction][modifier];
+	free_binding(binding);
+	if (argc == 0)
+		return true;
+
+	const char* argv[MAX_COMMAND_ARGS + 1];
+	memcpy(argv, args, sizeof(const char*) * argc);
+
+	bool navigation = argc >= 2 && strcmp(args[0], "workspace") == 0
+		&& (strcmp(args[1], "next") == 0 || strcmp(args[1], "prev") == 0);
+	if (navigation && (config->skip_empty || config->wrap_around)) {
+		binding->workspace_list = true;
+		bool has_wrap = false, other_flags = false;
+		for (int i = 2; i < argc; ++i) {
+			bool wrap_flag = strcmp(args[i], "--wrap-around") == 0;
+			has_wrap |= wrap_flag;
+			other_flags |= !wrap_flag;
+		}
+		if (config->wrap_around && !has_wrap)
+			argv[argc++] = "--wrap-around";
+		/* anything beyond --wrap-around is aerospace's to interpret */
+		if (!other_flags) {
+			binding->step = strcmp(args[1], "next") == 0 ? 1 : -1;
+			binding->wrap = config->wrap_around || has_wrap;
+		}
+	}
+
+	size_t label_len = 0;
+	for (int i = 0; i < argc; ++i)
+		label_len += strlen(argv[i]) + 1;
+	binding->label = malloc(label_len);
+	if (!binding->label || !aerospace_request_build(&binding->request, argv, argc)) {
+		free_binding(binding);
+		fprintf(stderr, "Config: memory allocation error.\n");
+		return false;
+	}
+	binding->label[0] = '\0';
+	for (int i = 0; i < argc; ++i) {
+		if (i)
+			strcat(binding->label, " ");
+		strcat(binding->label, argv[i]);
+	}
+	return true;
+}
+
+static bool compile_default_bindings(Config* config)
+{
+	const char* left[] = { "workspace", config->natural_swipe ? "next" : "prev" };
+	const char* right[] = { "workspace", config->natural_swipe ? "prev" : "next" };
+	return compile_binding(config, config->fingers, SWIPE_LEFT, MODIFIER_NONE, left, 2)
+		&& compile_binding(config, config->fingers, SWIPE_RIGHT, MODIFIER_NONE, right, 2);
+}
+
+static void index_bindings(Config* config)
+{
+	for (int f = MIN_FINGERS; f <= MAX_FINGERS; ++f) {
+		config->fingers_bound[f] = false;
+		config->vertical_bound[f] = false;
+		for (int d = 0; d < SWIPE_DIRECTIONS; ++d) {
+			for (int m = 0; m < MODIFIER_COUNT; ++m) {
+				if (!config->bindings[f - MIN_FINGERS][d][m].request.data)
+					continue;
+				config->fingers_bound[f] = true;
+				if (d == SWIPE_UP || d == SWIPE_DOWN)
+					config->vertical_bound[f] = true;
+			}
+		}
+	}
+}
+
+Config default_config(void)
+{
+	Config config = default_flags();
+	if (!compile_default_bindings(&config))
+		fprintf(stderr, "Config: failed to compile default bindings.\n");
+	index_bindings(&config);
+	return config;
+}
+
+static int read_file_to_buffer(const char* path, char** out)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return 0;
+
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fclose(file);
+		return 0;
+	}
+
+	*out = (char*)malloc(st.st_size + 1);
+	if (!*out) {
+		fclose(file);
+		return 0;
+	}
+
+	size_t read = fread(*out, 1, st.st_size, file);
+	(*out)[read] = '\0';
+	fclose(file);
+	return 1;
+}
+
+static bool read_bool(cJSON* root, const char* key, bool* out)
+{
+	cJSON* item = cJSON_GetObjectItem(root, key);
+	if (!item)
+		return true;
+	if (!cJSON_IsBool(item)) {
+		fprintf(stderr, "Config: '%s' must be true or false.\n", key);
+		return false;
+	}
+	*out = cJSON_IsTrue(item);
+	return true;
+}
+
+static int find_name(const char* const* names, int count, const char* name)
+{
+	for (int i = 0; i < count; ++i)
+		if (strcmp(names[i], name) == 0)
+			return i;
+	return -1;
+}
+
+/* Split a command given as a string on whitespace, or take it as an array of
+ * strings. The args point into storage (or the JSON), which must outlive them. */
+static int read_command(cJSON* command, const char** args, char* storage, size_t storage_len)
+{
+	int argc = 0;
+
+	if (cJSON_IsString(command)) {
+		if (strlen(command->valuestring) >= storage_len)
+			return -1;
+		strcpy(storage, command->valuestring);
+		char* save = NULL;
+		for (char* token = strtok_r(storage, " \t", &save); token; token = strtok_r(NULL, " \t", &save)) {
+			if (argc == MAX_COMMAND_ARGS)
+				return -1;
+			args[argc++] = token;
+		}
+		return argc > 0 ? argc : -1;
+	}
+
+	if (!cJSON_IsArray(command))
+		return -1;
+
+	cJSON* arg;
+	cJSON_ArrayForEach(arg, command)
+	{
+		if (!cJSON_IsString(arg) || argc == MAX_COMMAND_ARGS)
+			return -1;
+		args[argc++] = arg->valuestring;
+	}
+	return argc > 0 ? argc : -1;
+}
+
+static bool parse_bindings(cJSON* bindings, Config* config)
+{
+	if (!cJSON_IsArray(bindings)) {
+		fprintf(stderr, "Config: 'bindings' must be an array.\n");
+		return false;
+	}
+
+	int index = 0;
+	cJSON* entry;
+	cJSON_ArrayForEach(entry, bindings)
+	{
+		if (!cJSON_IsObject(entry)) {
+			fprintf(stderr, "Config: binding %d must be an object.\n", index);
+			return false;
+		}
+
+		int fingers = config->fingers;
+		cJSON* item = cJSON_GetObjectItem(entry, "fingers");
+		if (item) {
+			if (!cJSON_IsNumber(item) || item->valueint < MIN_FINGERS || item->valueint > MAX_FINGERS) {
+				fprintf(stderr, "Config: binding %d: 'fingers' must be a number between %d and %d.\n", index, MIN_FINGERS, MAX_FINGERS);
+				return false;
+			}
+			fingers = item->valueint;
+		}
+
+		item = cJSON_GetObjectItem(entry, "direction");
+		int direction = cJSON_IsString(item) ? find_name(direction_names, SWIPE_DIRECTIONS, item->valuestring) : -1;
+		if (direction < 0) {
+			fprintf(stderr, "Config: binding %d: 'direction' must be left, right, up or down.\n", index);
+			return false;
+		}
+
+		int modifier = MODIFIER_NONE;
+		item = cJSON_GetObjectItem(entry, "modifier");
+		if (item) {
+			modifier = cJSON_IsString(item) ? find_name(modifier_names, MODIFIER_COUNT, item->valuestring) : -1;
+			if (modifier < 0) {
+				fprintf(stderr, "Config: binding %d: 'modifier' must be none, shift, control, option or command.\n", index);
+				return false;
+			}
+		}
+
+		/* "command": null removes a binding, including the default ones */
+		const char* args[MAX_COMMAND_ARGS];
+		char storage[512];
+		int argc = 0;
+		item = cJSON_GetObjectItem(entry, "command");
+		if (!cJSON_IsNull(item)) {
+			argc = item ? read_command(item, args, storage, sizeof(storage)) : -1;
+			if (argc < 0) {
+				fprintf(stderr, "Config: binding %d: 'command' must be a non-empty string or array of at most %d strings.\n", index, MAX_COMMAND_ARGS);
+				return false;
+			}
+		}
+
+		if (!compile_binding(config, fingers, direction, modifier, args, argc))
+			return false;
+		index++;
+	}
+	return true;
+}
+
+static bool read_threshold(const cJSON* object, const char* key, bool zero_ok, double max, float scale,
+	float* out)
+{
+	const cJSON* item = cJSON_GetObjectItem(object, key);
+	if (!item)
+		return true;
+	if (!cJSON_IsNumber(item) || item->valuedouble < 0 || (!zero_ok && item->valuedouble == 0)
+		|| item->valuedouble > max) {
+		fprintf(stderr, "Config: 'thresholds.%s' must be a number %s 0 and at most %g.\n", key,
+			zero_ok ? "from" : "above", max);
+		return false;
+	}
+	*out = (float)(item->valuedouble * scale);
+	return true;
+}
+
+static bool read_profile(const cJSON* item, thresholds* out)
+{
+	if (cJSON_IsString(item)) {
+		for (int i = 0; i < THRESHOLD_PROFILES; ++i) {
+			if (strcmp(item->valuestring, threshold_profiles[i].name) == 0) {
+				*out = threshold_profiles[i].values;
+				return true;
+			}
+		}
+	}
+	fprintf(stderr, "Config: threshold profile must be \"default\", \"fast\" or \"conservative\".\n");
+	return false;
+}
+
+static bool read_limits(const cJSON* item, thresholds* out)
+{
+	return read_threshold(item, "swipe", false, 1.0, 1.0f, &out->swipe)
+		&& read_threshold(item, "velocity", false, 20.0, 1.0f, &out->velocity)
+		&& read_threshold(item, "cooldown_ms", false, 5000.0, 0.001f, &out->cooldown)
+		&& read_threshold(item, "grace_ms", true, 1000.0, 0.001f, &out->grace);
+}
+
+/* A profile name, or an object of a profile, values over it and per finger
+ * count overrides over those:
+ *   { "profile": "fast", "swipe": 0.1, "fingers": { "4": { "velocity": 1 } } } */
+static bool parse_thresholds(const cJSON* item, Config* config)
+{
+	thresholds base = threshold_profiles[0].values;
+	if (cJSON_IsString(item)) {
+		if (!read_profile(item, &base))
+			return false;
+	} else if (cJSON_IsObject(item)) {
+		const cJSON* profile = cJSON_GetObjectItem(item, "profile");
+		if ((profile && !read_profile(profile, &base)) || !read_limits(item, &base))
+			return false;
+	} else {
+		fprintf(stderr, "Config: 'thresholds' must be a profile name or an object.\n");
+		return false;
+	}
+	for (int f = 0; f <= MAX_FINGERS; ++f)
+		config->thresholds[f] = base;
+
+	const cJSON* fingers = cJSON_IsObject(item) ? cJSON_GetObjectItem(item, "fingers") : NULL;
+	if (!fingers)
+		return true;
+	if (!cJSON_IsObject(fingers)) {
+		fprintf(stderr, "Config: 'thresholds.fingers' must be an object keyed by finger count.\n");
+		return false;
+	}
+	const cJSON* entry;
+	cJSON_ArrayForEach(entry, fingers)
+	{
+		char* end;
+		long count = strtol(entry->string, &end, 10);
+		if (*end || count < MIN_FINGERS || count > MAX_FINGERS || !cJSON_IsObject(entry)) {
+			fprintf(stderr, "Config: 'thresholds.fingers' keys must be %d to %d, each with an object.\n",
+				MIN_FINGERS, MAX_FINGERS);
+			return false;
+		}
+		const cJSON* profile = cJSON_GetObjectItem(entry, "profile");
+		if ((profile && !read_profile(profile, &config->thresholds[count]))
+			|| !read_limits(entry, &config->thresholds[count]))
+			return false;
+	}
+	return true;
+}
+
+/* true/false, or an object of overrides that also enables it */
+static bool parse_prediction(const cJSON* item, prediction* out)
+{
+	if (cJSON_IsBool(item)) {
+		out->enabled = cJSON_IsTrue(item);
+		return true;
+	}
+	if (!cJSON_IsObject(item)) {
+		fprintf(stderr, "Config: 'prediction' must be a boolean or an object.\n");
+		return false;
+	}
+
+	out->enabled = true;
+	const cJSON* horizon = cJSON_GetObjectItem(item, "horizon_ms");
+	if (horizon) {
+		if (!cJSON_IsNumber(horizon) || horizon->valuedouble <= 0 || horizon->valuedouble > 200) {
+			fprintf(stderr, "Config: 'prediction.horizon_ms' must be between 0 and 200.\n");
+			return false;
+		}
+		out->horizon = (float)(horizon->valuedouble / 1000.0);
+	}
+	const cJSON* confidence = cJSON_GetObjectItem(item, "confidence");
+	if (confidence) {
+		if (!cJSON_IsNumber(confidence) || confidence->valuedouble < 0 || confidence->valuedouble > 1) {
+			fprintf(stderr, "Config: 'prediction.confidence' must be between 0 and 1.\n");
+			return false;
+		}
+		out->confidence = (float)confidence->valuedouble;
+	}
+	return true;
+}
+
+bool config_parse(const char* json, Config* out)
+{
+	Config config = default_flags();
+
+	cJSON* root = cJSON_Parse(json);
+	if (!root) {
+		fprintf(stderr, "Failed to parse config JSON.\n");
+		return false;
+	}
+	if (!cJSON_IsObject(root)) {
+		fprintf(stderr, "Config: top level must be an object.\n");
+		cJSON_Delete(root);
+		return false;
+	}
+
+	bool ok = read_bool(root, "natural_swipe", &config.natural_swipe)
+		&& read_bool(root, "wrap_around", &config.wrap_around)
+		&& read_bool(root, "skip_empty", &config.skip_empty)
+		/* "haptics" is the documented key, "haptic" the historical one */
+		&& read_bool(root, "haptic", &config.haptic)
+		&& read_bool(root, "haptics", &config.haptic);
+
+	cJSON* item = cJSON_GetObjectItem(root, "haptic_policy");
+	if (ok && item) {
+		if (cJSON_IsString(item) && strcmp(item->valuestring, "recognition") == 0) {
+			config.haptic_policy = HAPTIC_ON_RECOGNITION;
+		} else if (cJSON_IsString(item) && strcmp(item->valuestring, "switch") == 0) {
+			config.haptic_policy = HAPTIC_ON_SWITCH;
+		} else {
+			fprintf(stderr, "Config: 'haptic_policy' must be \"recognition\" or \"switch\".\n");
+			ok = false;
+		}
+	}
+
+	item = cJSON_GetObjectItem(root, "log_level");
+	if (ok && item) {
+		if (!cJSON_IsString(item) || !log_parse_level(item->valuestring, &config.log_level)) {
+			fprintf(stderr, "Config: 'log_level' must be \"error\", \"warn\", \"info\" or \"debug\".\n");
+			ok = false;
+		}
+	}
+
+	item = cJSON_GetObjectItem(root, "thresholds");
+	if (ok && item)
+		ok = parse_thresholds(item, &config);
+
+	item = cJSON_GetObjectItem(root, "prediction");
+	if (ok && item)
+		ok = parse_prediction(item, &config.prediction);
+
+	item = cJSON_GetObjectItem(root, "fingers");
+	if (ok && item) {
+		if (!cJSON_IsNumber(item) || item->valueint < MIN_FINGERS || item->valueint > MAX_FINGERS) {
+			fprintf(stderr, "Config: 'fingers' must be a number between %d and %d.\n", MIN_FINGERS, MAX_FINGERS);
+			ok = false;
+		} else {
+			config.fingers = item->valueint;
+		}
+	}
+
+	ok = ok && compile_default_bindings(&config);
+
+	item = cJSON_GetObjectItem(root, "bindings");
+	if (ok && item)
+		ok = parse_bindings(item, &config);
+
+	cJSON_Delete(root);
+	if (!ok) {
+		config_free(&config);
+		return false;
+	}
+
+	index_bindings(&config);
+	*out = config;
+	return true;
+}
+
+char* config_path(void)
+{
+	if (access("./config.json", R_OK) == 0)
+		return strdup("./config.json");
+
+	struct passwd* pw = getpwuid(getuid());
+	if (!pw)
+		return NULL;
+
+	size_t len = snprintf(NULL, 0, "%s/.config/aerospace-swipe/config.json", pw->pw_dir);
+	char* path = malloc(len + 1);
+	if (path)
+		snprintf(path, len + 1, "%s/.config/aerospace-swipe/config.json", pw->pw_dir);
+	return path;
+}
+
+Config load_config(void)
+{
+	Config config = default_config();
+
+	char* buffer = NULL;
+	char* path = config_path();
+	if (path && read_file_to_buffer(path, &buffer))
+		printf("Loaded config from: %s\n", path);
+	free(path);
+
+	if (!buffer) {
+		fprintf(stderr, "Using default configuration.\n");
+		return config;
+	}
+
+	Config parsed;
+	if (config_parse(buffer, &parsed)) {
+		config_free(&config);
+		config = parsed;
+	} else {
+		fprintf(stderr, "Invalid config. Using defaults.\n");
+	}
+	free(buffer);
+	return config;
+}
+
+/* the float as written in a config, not its nearest double */
+static double tidy(float value)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.6g", value);
+	return strtod(buf, NULL);
+}
+
+static cJSON* describe_thresholds(const thresholds* values)
+{
+	cJSON* item = cJSON_CreateObject();
+	cJSON_AddNumberToObject(item, "swipe", tidy(values->swipe));
+	cJSON_AddNumberToObject(item, "velocity", tidy(values->velocity));
+	cJSON_AddNumberToObject(item, "cooldown_ms", tidy(values->cooldown * 1000.0f));
+	cJSON_AddNumberToObject(item, "grace_ms", tidy(values->grace * 1000.0f));
+	return item;
+}
+
+cJSON* config_describe(const Config* config)
+{
+	cJSON* root = cJSON_CreateObject();
+	if (!root)
+		return NULL;
+	cJSON_AddBoolToObject(root, "natural_swipe", config->natural_swipe);
+	cJSON_AddBoolToObject(root, "wrap_around", config->wrap_around);
+	cJSON_AddBoolToObject(root, "skip_empty", config->skip_empty);
+	cJSON_AddBoolToObject(root, "haptics", config->haptic);
+	cJSON_AddStringToObject(root, "haptic_policy",
+		config->haptic_policy == HAPTIC_ON_RECOGNITION ? "recognition" : "switch");
+	cJSON_AddNumberToObject(root, "fingers", config->fingers);
+	cJSON_AddStringToObject(root, "log_level", log_level_name(config->log_level));
+
+	cJSON* limits = cJSON_AddObjectToObject(root, "thresholds");
+	cJSON* per_count = cJSON_AddObjectToObject(limits, "fingers");
+	for (int f = MIN_FINGERS; f <= MAX_FINGERS; ++f) {
+		if (!config->fingers_bound[f])
+			continue;
+		char key[4];
+		snprintf(key, sizeof(key), "%d", f);
+		cJSON_AddItemToObject(per_count, key, describe_thresholds(&config->thresholds[f]));
+	}
+
+	if (config->prediction.enabled) {
+		cJSON* item = cJSON_AddObjectToObject(root, "prediction");
+		cJSON_AddNumberToObject(item, "horizon_ms", tidy(config->prediction.horizon * 1000.0f));
+		cJSON_AddNumberToObject(item, "confidence", tidy(config->prediction.confidence));
+	} else {
+		cJSON_AddFalseToObject(root, "prediction");
+	}
+
+	cJSON* bindings = cJSON_AddArrayToObject(root, "bindings");
+	for (int f = MIN_FINGERS; f <= MAX_FINGERS; ++f) {
+		for (int d = 0; d < SWIPE_DIRECTIONS; ++d) {
+			for (int m = 0; m < MODIFIER_COUNT; ++m) {
+				const Binding* binding = &config->bindings[f - MIN_FINGERS][d][m];
+				if (!binding->request.data)
+					continue;
+				cJSON* entry = cJSON_CreateObject();
+				cJSON_AddNumberToObject(entry, "fingers", f);
+				cJSON_AddStringToObject(entry, "direction", direction_names[d]);
+				cJSON_AddStringToObject(entry, "modifier", modifier_names[m]);
+				cJSON_AddStringToObject(entry, "command", binding->label);
+				cJSON_AddItemToArray(bindings, entry);
+			}
+		}
+	}
+	return root;
+}
+
+bool config_parse_gesture(const char* direction, const char* modifier, swipe_direction* direction_out,
+	swipe_modifier* modifier_out)
+{
+	int d = find_name(direction_names, SWIPE_DIRECTIONS, direction);
+	int m = modifier ? find_name(modifier_names, MODIFIER_COUNT, modifier) : MODIFIER_NONE;
+	if (d < 0 || m < 0)
+		return false;
+	*direction_out = (swipe_direction)d;
+	*modifier_out = (swipe_modifier)m;
+	return true;
+}
+
+const Config* config_acquire(void)
+{
+	/* seq_cst throughout: publish must not miss a reader that loaded the
+	 * snapshot it is replacing but has not pinned it yet */
+	atomic_fetch_add(&acquiring, 1);
+	snapshot* pinned = atomic_load(&current);
+	atomic_fetch_add(&pinned->readers, 1);
+	atomic_fetch_sub_explicit(&acquiring, 1, memory_order_release);
+	return &pinned->config;
+}
+
+void config_release(const Config* config)
+{
+	atomic_fetch_sub_explicit(&((snapshot*)config)->readers, 1, memory_order_release);
+}
+
+/* takes ownership of the bindings in config; the caller holds reload_lock */
+static void publish(Config* config)
+{
+	snapshot* fresh = malloc(sizeof(snapshot));
+	if (!fresh) {
+		fprintf(stderr, "Config: memory allocation error, keeping old config.\n");
+		config_free((Config*)config);
+		return;
+	}
+	fresh->config = *config;
+	atomic_init(&fresh->readers, 0);
+	fresh->next_retired = NULL;
+
+	log_set_level(fresh->config.log_level);
+	snapshot* old = atomic_exchange(&current, fresh);
+	if (old) {
+		old->next_retired = retired;
+		retired = old;
+	}
+	/* anyone still on the old snapshot has pinned it once this drains, a
+	 * window of a few instructions */
+	while (atomic_load(&acquiring) != 0)
+		sched_yield();
+	/* a snapshot pinned across a command is reclaimed by a later reload */
+	for (snapshot** link = &retired; *link;) {
+		snapshot* candidate = *link;
+		if (atomic_load_explicit(&candidate->readers, memory_order_acquire) == 0) {
+			*link = candidate->next_retired;
+			config_free(&candidate->config);
+			free(candidate);
+		} else {
+			link = &candidate->next_retired;
+		}
+	}
+}
+
+void config_init(void)
+{
+	pthread_mutex_lock(&reload_lock);
+	Config config = load_config();
+	publish(&config);
+	pthread_mutex_unlock(&reload_lock);
+}
+
+static bool reload_locked(void)
+{
+	char* buffer = NULL;
+	char* path = config_path();
+	if (!path || !read_file_to_buffer(path, &buffer)) {
+		fprintf(stderr, "Config: could not read %s, keeping current config.\n", path ? path : "config");
+		flight_record_event(FR_CONFIG, 0, FR_FAILED, 0, 0, 0);
+		free(path);
+		return false;
+	}
+
+	Config config;
+	bool ok = config_parse(buffer, &config);
+	free(buffer);
+	if (!ok) {
+		fprintf(stderr, "Config: %s is invalid, keeping current config.\n", path);
+		flight_record_event(FR_CONFIG, 0, FR_FAILED, 0, 0, 0);
+		free(path);
+		return false;
+	}
+
+	publish(&config);
+	flight_record_event(FR_CONFIG, 0, 0, 0, 0, 0);
+	printf("Reloaded config from: %s\n", path);
+	free(path);
+	return true;
+}
+
+bool config_reload(void)
+{
+	pthread_mutex_lock(&reload_lock);
+	bool ok = reload_locked();
+	pthread_mutex_unlock(&reload_lock);
+	return ok;
+}
@@ -1,119 +1,128 @@
+#ifndef CONFIG_H
 #define CONFIG_H
 
+#include "aerospace.h"
 #include "cJSON.h"
-#include <pwd.h>
+#include "haptic_queue.h"
+#include "log.h"
 #include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <sys/stat.h>
-#include <unistd.h>
+
+#define MIN_FINGERS 2
+#define MAX_FINGERS 5
+
+typedef enum {
+	SWIPE_LEFT,
+	SWIPE_RIGHT,
+	SWIPE_UP,
+	SWIPE_DOWN,
+	SWIPE_DIRECTIONS
+} swipe_direction;
+
+typedef enum {
+	MODIFIER_NONE,
+	MODIFIER_SHIFT,
+	MODIFIER_CONTROL,
+	MODIFIER_OPTION,
+	MODIFIER_COMMAND,
+	MODIFIER_COUNT
+} swipe_modifier;
+
+/* A gesture bound to an aerospace command, compiled when the config loads. */
+typedef struct {
+	aerospace_request request; /* request.data is NULL when unbound */
+	char* label; /* command line, for logging */
+	bool workspace_list; /* splice the focused monitor's workspaces into stdin */
+	/* workspaces "workspace next|prev" moves, +1 or -1, resolved locally
+	 * against the listing; 0 when the command goes to aerospace as is */
+	int step;
+	bool wrap; /* step around the ends */
+} Binding;
+
+/* Recognizer tuning; distances are in normalized trackpad widths. */
+typedef struct {
+	float swipe; /* centroid travel that triggers */
+	float velocity; /* mean horizontal velocity that triggers, widths/s */
+	float cooldown; /* seconds after a trigger before the next gesture */
+	float grace; /* seconds a changed finger count may last mid gesture */
+} thresholds;
+
+/* Early trigger from the extrapolated centroid trajectory. */
+typedef struct {
+	bool enabled;
+	float horizon; /* seconds to extrapolate ahead */
+	float confidence; /* minimum R^2 of the trajectory fit */
+} prediction;
 
 typedef struct {
 	bool natural_swipe;
 	bool wrap_around;
 	bool haptic;
+	haptic_policy haptic_policy;
 	bool skip_empty;
 	int fingers;
-	const char* swipe_left;
-	const char* swipe_right;
+	log_level log_level;
+	/* indexed by finger count, with profile and overrides already applied */
+	thresholds thresholds[MAX_FINGERS + 1];
+	prediction prediction;
+	/* indexed [fingers - MIN_FINGERS][direction][modifier] */
+	Binding bindings[MAX_FINGERS - MIN_FINGERS + 1][SWIPE_DIRECTIONS][MODIFIER_COUNT];
+	bool fingers_bound[MAX_FINGERS + 1];
+	bool vertical_bound[MAX_FINGERS + 1];
 } Config;
 
-static Config default_config()
+/* O(1) lookup of the binding for a gesture. A modifier without its own
+ * binding falls back to the unmodified one; NULL when nothing is bound. */
+static inline const Binding* config_binding(const Config* config, int fingers,
+	swipe_direction direction, swipe_modifier modifier)
 {
-	Config config;
-	config.natural_swipe = false;
-	config.wrap_around = true;
-	config.haptic = false;
-	config.skip_empty = true;
-	config.fingers = 3;
-	config.swipe_left = "prev";
-	config.swipe_right = "next";
-	return config;
+	if (fingers < MIN_FINGERS || fingers > MAX_FINGERS)
+		return NULL;
+
+	const Binding* row = config->bindings[fingers - MIN_FINGERS][direction];
+	if (row[modifier].request.data)
+		return &row[modifier];
+	if (row[MODIFIER_NONE].request.data)
+		return &row[MODIFIER_NONE];
+	return NULL;
 }
 
-static int read_file_to_buffer(const char* path, char** out)
-{
-	FILE* file = fopen(path, "rb");
-	if (!file)
-		return 0;
-
-	struct stat st;
-	if (stat(path, &st) != 0) {
-		fclose(file);
-		return 0;
-	}
-
-	*out = (char*)malloc(st.st_size + 1);
-	if (!*out) {
-		fclose(file);
-		return 0;
-	}
-
-	fread(*out, 1, st.st_size, file);
-	(*out)[st.st_size] = '\0';
-	fclose(file);
-	return 1;
-}
+Config default_config(void);
 
-static Config load_config()
-{
-	Config config = default_config();
-
-	char* buffer = NULL;
-	const char* paths[] = { "./config.json", NULL };
-
-	char fallback_path[512];
-	struct passwd* pw = getpwuid(getuid());
-	if (pw) {
-		snprintf(fallback_path, sizeof(fallback_path),
-			"%s/.config/aerospace-swipe/config.json", pw->pw_dir);
-		paths[1] = fallback_path;
-	}
-
-	for (int i = 0; i < 2; ++i) {
-		if (paths[i] && read_file_to_buffer(paths[i], &buffer)) {
-			printf("Loaded config from: %s\n", paths[i]);
-			break;
-		}
-	}
-
-	if (!buffer) {
-		fprintf(stderr, "Using default configuration.\n");
-		return config;
-	}
-
-	cJSON* root = cJSON_Parse(buffer);
-	free(buffer);
-	if (!root) {
-		fprintf(stderr, "Failed to parse config JSON. Using defaults.\n");
-		return config;
-	}
-
-	cJSON* item;
-
-	item = cJSON_GetObjectItem(root, "natural_swipe");
-	if (cJSON_IsBool(item))
-		config.natural_swipe = cJSON_IsTrue(item);
-
-	item = cJSON_GetObjectItem(root, "wrap_around");
-	if (cJSON_IsBool(item))
-		config.wrap_around = cJSON_IsTrue(item);
-
-	item = cJSON_GetObjectItem(root, "haptic");
-	if (cJSON_IsBool(item))
-		config.haptic = cJSON_IsTrue(item);
-
-	item = cJSON_GetObjectItem(root, "skip_empty");
-	if (cJSON_IsBool(item))
-		config.skip_empty = cJSON_IsTrue(item);
-
-	item = cJSON_GetObjectItem(root, "fingers");
-	if (cJSON_IsNumber(item))
-		config.fingers = item->valueint;
-
-	config.swipe_left = config.natural_swipe ? "next" : "prev";
-	config.swipe_right = config.natural_swipe ? "prev" : "next";
-
-	cJSON_Delete(root);
-	return config;
-}
+/* Release the bindings owned by a config. */
+void config_free(Config* config);
+
+/* Parse and validate a config document on top of the defaults and compile its
+ * bindings. On failure *out is left untouched and false is returned. */
+bool config_parse(const char* json, Config* out);
+
+/* Path of the config file: ./config.json when present, otherwise
+ * ~/.config/aerospace-swipe/config.json (which may not exist yet). The caller
+ * frees the result. */
+char* config_path(void);
+
+Config load_config(void);
+
+/* The config as it runs, in the config file's terms: flags, thresholds for
+ * every bound finger count and each binding's compiled command line. The
+ * caller deletes it. */
+cJSON* config_describe(const Config* config);
+
+/* A direction and optional modifier by their config file names. */
+bool config_parse_gesture(const char* direction, const char* modifier, swipe_direction* direction_out,
+	swipe_modifier* modifier_out);
+
+/* Lock-free access to the live config. The returned snapshot is immutable and
+ * stays valid, whatever reloads happen meanwhile, until it is released;
+ * pin it for as long as its bindings are in use, command included. */
+const Config* config_acquire(void);
+void config_release(const Config* config);
+
+/* Publish the initial config (from load_config). */
+void config_init(void);
+
+/* Re-read, validate and atomically publish the config file. A missing or
+ * invalid file keeps the running config. Safe from any thread; concurrent
+ * reloads run one after the other. */
+bool config_reload(void);
+
+#endif
@@ -0,0 +1,185 @@
+#include "config_watch.h"
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+/* editors save in several steps (truncate, write, rename); wait for the burst
+ * to settle before parsing */
+#define RELOAD_SETTLE_NS 50000000L
+
+typedef struct {
+	char* dir;
+	char* name;
+} watch_target;
+
+static void settle(void)
+{
+	struct timespec ts = { 0, RELOAD_SETTLE_NS };
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+		;
+}
+
+#if defined(__APPLE__)
+static int open_vnode(int kq, const char* path, unsigned int fflags)
+{
+	int fd = open(path, O_EVTONLY);
+	if (fd < 0)
+		return -1;
+
+	struct kevent change;
+	EV_SET(&change, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, fflags, 0, NULL);
+	if (kevent(kq, &change, 1, NULL, 0, NULL) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void* watch_thread(void* arg)
+{
+	watch_target* target = arg;
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", target->dir, target->name);
+
+	int kq = kqueue();
+	if (kq < 0) {
+		fprintf(stderr, "Config watch: kqueue failed: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	/* the directory catches atomic saves (rename over the file) and creation,
+	 * the file itself catches in-place writes */
+	int dir_fd = open_vnode(kq, target->dir, NOTE_WRITE);
+	if (dir_fd < 0) {
+		fprintf(stderr, "Config watch: cannot watch %s: %s\n", target->dir, strerror(errno));
+		close(kq);
+		return NULL;
+	}
+	const unsigned int file_flags = NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME;
+	int file_fd = open_vnode(kq, path, file_flags);
+
+	for (;;) {
+		struct kevent event;
+		int n = kevent(kq, NULL, 0, &event, 1, NULL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Config watch: kevent failed: %s\n", strerror(errno));
+			break;
+		}
+		if (n == 0)
+			continue;
+
+		settle();
+
+		/* the file may have been replaced; drop the stale vnode and rewatch */
+		if (file_fd >= 0)
+			close(file_fd);
+		file_fd = open_vnode(kq, path, file_flags);
+		if (file_fd >= 0)
+			config_reload();
+	}
+
+	if (file_fd >= 0)
+		close(file_fd);
+	close(dir_fd);
+	close(kq);
+	return NULL;
+}
+#elif defined(__linux__)
+static void* watch_thread(void* arg)
+{
+	watch_target* target = arg;
+
+	int fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Config watch: inotify_init failed: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	if (inotify_add_watch(fd, target->dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		fprintf(stderr, "Config watch: cannot watch %s: %s\n", target->dir, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	for (;;) {
+		ssize_t len = read(fd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Config watch: read failed: %s\n", strerror(errno));
+			break;
+		}
+
+		bool relevant = false;
+		for (char* p = buf; p < buf + len;) {
+			struct inotify_event* event = (struct inotify_event*)p;
+			if (event->len && strcmp(event->name, target->name) == 0)
+				relevant = true;
+			p += sizeof(struct inotify_event) + event->len;
+		}
+
+		if (relevant) {
+			settle();
+			config_reload();
+		}
+	}
+
+	close(fd);
+	return NULL;
+}
+#endif
+
+bool config_watch_start(void)
+{
+#if defined(__APPLE__) || defined(__linux__)
+	char* path = config_path();
+	if (!path)
+		return false;
+
+	/* dirname/basename may modify their argument */
+	char* dir_copy = strdup(path);
+	char* name_copy = strdup(path);
+	watch_target* target = malloc(sizeof(watch_target));
+	if (!dir_copy || !name_copy || !target) {
+		free(path);
+		free(dir_copy);
+		free(name_copy);
+		free(target);
+		return false;
+	}
+	target->dir = strdup(dirname(dir_copy));
+	target->name = strdup(basename(name_copy));
+	free(dir_copy);
+	free(name_copy);
+	free(path);
+
+	pthread_t thread;
+	if (!target->dir || !target->name || pthread_create(&thread, NULL, watch_thread, target) != 0) {
+		fprintf(stderr, "Config watch: failed to start watcher thread.\n");
+		free(target->dir);
+		free(target->name);
+		free(target);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <stdbool.h>
+
+/* Watch the config file (kqueue on macOS, inotify on Linux) and call
+ * config_reload on a background thread whenever it changes. */
+bool config_watch_start(void);
@@ -0,0 +1,107 @@
+#include "contact_table.h"
+#include <string.h>
+
+/* identity hashes tend to be small sequential integers or aligned pointers;
+ * the murmur3 finalizer spreads them over the low bits used for the index */
+static uint32_t slot_index(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	key ^= key >> 33;
+	return (uint32_t)key & (CONTACT_SLOTS - 1);
+}
+
+static bool is_stale(const contact_table* table, const contact* entry)
+{
+	return table->generation - entry->seen > CONTACT_STALE_FRAMES;
+}
+
+void contact_table_init(contact_table* table)
+{
+	memset(table, 0, sizeof(*table));
+	/* generation 0 is reserved for never used slots */
+	table->generation = CONTACT_STALE_FRAMES + 1;
+}
+
+void contact_table_next_frame(contact_table* table)
+{
+	if (++table->generation == 0)
+		table->generation = 1;
+}
+
+contact* contact_table_get(contact_table* table, uint64_t key, bool* created)
+{
+	uint32_t index = slot_index(key);
+	contact* reusable = NULL;
+	contact* oldest = NULL;
+
+	/* a never used slot ends the probe: the key cannot be further along */
+	for (int probe = 0; probe < CONTACT_SLOTS; ++probe) {
+		contact* entry = &table->slots[(index + probe) & (CONTACT_SLOTS - 1)];
+		if (entry->seen == 0) {
+			if (!reusable)
+				reusable = entry;
+			break;
+		}
+
+		bool stale = is_stale(table, entry);
+		if (entry->key == key && !stale) {
+			entry->seen = table->generation;
+			*created = false;
+			return entry;
+		}
+		if (stale && !reusable)
+			reusable = entry;
+		if (!oldest || table->generation - entry->seen > table->generation - oldest->seen)
+			oldest = entry;
+	}
+
+	if (!reusable) {
+		/* every slot holds a live contact; displace the least recently seen */
+		reusable = oldest;
+		table->evictions++;
+	}
+
+	reusable->key = key;
+	reusable->seen = table->generation;
+	velocity_reset(&reusable->history);
+	*created = true;
+	return reusable;
+}
+
+void contact_table_end(contact_table* table, contact* entry)
+{
+	/* stale rather than never used, so probes for keys behind it still work */
+	entry->seen = table->generation - CONTACT_STALE_FRAMES - 1;
+	if (entry->seen == 0)
+		entry->seen = (uint32_t)-1;
+}
+
+touch contact_table_convert(contact_table* table, uint64_t id, double x, double y, int phase,
+	double timestamp)
+{
+	touch result = { .id = id, .x = x, .y = y, .phase = phase, .timestamp = timestamp };
+
+	bool created;
+	contact* entry = contact_table_get(table, id, &created);
+	entry->x = x;
+	entry->y = y;
+	entry->timestamp = timestamp;
+	velocity_add(&entry->history, timestamp, x);
+	velocity_estimate(&entry->history, &result.velocity);
+
+	if (phase & (TOUCH_PHASE_ENDED | TOUCH_PHASE_CANCELLED))
+		contact_table_end(table, entry);
+	return result;
+}
+
+int contact_table_live(const contact_table* table)
+{
+	int live = 0;
+	for (int i = 0; i < CONTACT_SLOTS; ++i)
+		if (table->slots[i].seen != 0 && !is_stale(table, &table->slots[i]))
+			live++;
+	return live;
+}
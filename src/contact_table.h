@@ -0,0 +1,52 @@
+#pragma once
+#include "touch.h"
+#include "velocity.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Per-finger state for touch conversion, keyed by the integer hash of the
+ * touch identity. Open addressing over a fixed array: no allocation after
+ * init, and memory stays bounded however many touches the process sees.
+ *
+ * Every frame bumps the generation. A contact not seen for
+ * CONTACT_STALE_FRAMES generations is stale and its slot is reused, so a
+ * touch that vanishes without an end phase costs nothing beyond that. */
+
+#define CONTACT_SLOTS 32 /* power of two; a trackpad reports at most ~11 */
+#define CONTACT_STALE_FRAMES 16
+
+typedef struct {
+	uint64_t key;
+	uint32_t seen; /* generation of the last update, 0 for a never used slot */
+	double x;
+	double y;
+	double timestamp;
+	velocity_window history;
+} contact;
+
+typedef struct {
+	contact slots[CONTACT_SLOTS];
+	uint32_t generation;
+	uint64_t evictions; /* live contacts displaced because the table was full */
+} contact_table;
+
+void contact_table_init(contact_table* table);
+
+/* Call once per frame before looking up its contacts. */
+void contact_table_next_frame(contact_table* table);
+
+/* The contact for key, marked seen in this frame. *created is set when the
+ * slot is new (or was stale), in which case its history is empty and its
+ * position fields are undefined until the caller fills them in. Never NULL. */
+contact* contact_table_get(contact_table* table, uint64_t key, bool* created);
+
+/* The touch ended; its slot is free for reuse right away. */
+void contact_table_end(contact_table* table, contact* entry);
+
+/* Look up id, extend its history and return the touch with its velocity.
+ * Ended and cancelled touches release their slot. */
+touch contact_table_convert(contact_table* table, uint64_t id, double x, double y, int phase,
+	double timestamp);
+
+/* Live (non-stale) contacts; for diagnostics and benchmarks. */
+int contact_table_live(const contact_table* table);
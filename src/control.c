@@ -0,0 +1,406 @@
+#include "control.h"
+#include "executor.h"
+#include "flight_recorder.h"
+#include "log.h"
+#include "recognizer.h"
+#include "stats.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CONTROL_LINE 512
+#define CONTROL_ARGS 8
+
+/* a synthesized swipe: this far across, one frame every FRAME_SECONDS */
+#define SWIPE_TRAVEL 0.4f
+#define SWIPE_FRAMES 16
+#define FRAME_SECONDS 0.008
+
+/* end of the last synthesized swipe; guarded by the synthetic device's lock */
+static double synthetic_until;
+
+typedef struct {
+	int fd;
+	control_hooks hooks;
+	uint64_t started_ns;
+} control_server;
+
+typedef struct {
+	const control_server* server;
+	int conn;
+} control_connection;
+
+static cJSON* failure(const char* error)
+{
+	cJSON* reply = cJSON_CreateObject();
+	cJSON_AddFalseToObject(reply, "ok");
+	cJSON_AddStringToObject(reply, "error", error);
+	return reply;
+}
+
+static cJSON* success(void)
+{
+	cJSON* reply = cJSON_CreateObject();
+	cJSON_AddTrueToObject(reply, "ok");
+	return reply;
+}
+
+static cJSON* status(const control_server* server)
+{
+	cJSON* reply = success();
+	cJSON_AddNumberToObject(reply, "pid", getpid());
+	cJSON_AddNumberToObject(reply, "uptime_s", (stats_now_ns() - server->started_ns) / 1e9);
+
+	device_state states[MAX_DEVICES];
+	int count = devices_save(states, MAX_DEVICES);
+	cJSON* devices = cJSON_AddArrayToObject(reply, "devices");
+	for (int i = 0; i < count; ++i) {
+		char id[24];
+		snprintf(id, sizeof(id), "%llx", (unsigned long long)states[i].id);
+		cJSON_AddItemToArray(devices, cJSON_CreateString(id));
+	}
+	if (server->hooks.status)
+		server->hooks.status(reply);
+	return reply;
+}
+
+static cJSON* stats(void)
+{
+	char* json = stats_snapshot_json();
+	cJSON* snapshot = json ? cJSON_Parse(json) : NULL;
+	cJSON_free(json);
+	if (!snapshot)
+		return failure("no snapshot");
+	cJSON* reply = success();
+	cJSON_AddItemToObject(reply, "stats", snapshot);
+	return reply;
+}
+
+static cJSON* dump(const char* path)
+{
+	char* fallback = path ? NULL : flight_recorder_path();
+	if (!path)
+		path = fallback;
+	cJSON* reply = path && flight_recorder_dump(path) ? success() : failure("could not write the flight recorder");
+	if (path)
+		cJSON_AddStringToObject(reply, "path", path);
+	free(fallback);
+	return reply;
+}
+
+/* fingers direction [modifier] */
+static bool parse_gesture(char** args, int argc, int* fingers, swipe_direction* direction,
+	swipe_modifier* modifier)
+{
+	if (argc < 3 || argc > 4)
+		return false;
+	char* end;
+	long count = strtol(args[1], &end, 10);
+	if (*end || count < MIN_FINGERS || count > MAX_FINGERS)
+		return false;
+	*fingers = (int)count;
+	return config_parse_gesture(args[2], argc == 4 ? args[3] : NULL, direction, modifier);
+}
+
+static void add_timing(cJSON* reply, const Binding* binding, uint64_t start, uint64_t recognized,
+	uint64_t done)
+{
+	cJSON_AddItemToObject(reply, "command", binding ? cJSON_CreateString(binding->label) : cJSON_CreateNull());
+	cJSON_AddNumberToObject(reply, "recognize_us", (recognized - start) / 1e3);
+	cJSON_AddNumberToObject(reply, "us", (done - start) / 1e3);
+}
+
+static void release_config(const control_server* server, const Config* config)
+{
+	if (server->hooks.release)
+		server->hooks.release(config);
+}
+
+static cJSON* run(const control_server* server, char** args, int argc)
+{
+	int fingers;
+	swipe_direction direction;
+	swipe_modifier modifier;
+	if (!parse_gesture(args, argc, &fingers, &direction, &modifier))
+		return failure("usage: run fingers left|right|up|down [modifier]");
+
+	gesture_device* device = devices_get(CONTROL_DEVICE);
+	if (!device)
+		return failure("no room for the synthetic device");
+	uint64_t start = stats_now_ns();
+	const Config* config = server->hooks.config();
+	const Binding* binding = config_binding(config, fingers, direction, modifier);
+	if (!binding) {
+		release_config(server, config);
+		return failure("nothing is bound to that gesture");
+	}
+	server->hooks.run(device, config, binding, start);
+
+	cJSON* reply = success();
+	add_timing(reply, binding, start, start, stats_now_ns());
+	release_config(server, config);
+	return reply;
+}
+
+/* The frames of a straight swipe, fed as they would arrive but without
+ * waiting between them, then a lift to end the gesture. Timestamps start
+ * now, or a cooldown after the last synthesized swipe if that is later:
+ * the recognizer never sees time go backwards, and back to back requests
+ * each get a gesture of their own however fast they come. */
+static cJSON* swipe(const control_server* server, char** args, int argc)
+{
+	int fingers;
+	swipe_direction direction;
+	swipe_modifier modifier;
+	if (!parse_gesture(args, argc, &fingers, &direction, &modifier))
+		return failure("usage: swipe fingers left|right|up|down [modifier]");
+
+	gesture_device* device = devices_get(CONTROL_DEVICE);
+	if (!device)
+		return failure("no room for the synthetic device");
+
+	float dx = direction == SWIPE_LEFT ? -1.0f : direction == SWIPE_RIGHT ? 1.0f : 0.0f;
+	float dy = direction == SWIPE_UP ? 1.0f : direction == SWIPE_DOWN ? -1.0f : 0.0f;
+	float step = SWIPE_TRAVEL / SWIPE_FRAMES;
+	uint64_t start = stats_now_ns();
+	const Config* config = server->hooks.config();
+	const Binding* binding = NULL;
+	int fed = 0;
+
+	touch_frame frame __attribute__((aligned(64)));
+	pthread_mutex_lock(&device->lock);
+	double earliest = synthetic_until + config->thresholds[fingers].cooldown;
+	double t0 = start / 1e9 > earliest ? start / 1e9 : earliest;
+	for (int f = 0; f <= SWIPE_FRAMES && !binding; ++f, ++fed) {
+		double t = t0 + f * FRAME_SECONDS;
+		touch_frame_init(&frame, CONTROL_DEVICE, t);
+		for (int i = 0; i < fingers; ++i) {
+			touch contact = {
+				.id = (uint64_t)i + 1,
+				.x = 0.5 - dx * SWIPE_TRAVEL / 2 + dx * step * f + (i - fingers / 2.0) * 0.05,
+				.y = 0.5 - dy * SWIPE_TRAVEL / 2 + dy * step * f,
+				.phase = f == 0 ? 1 : 2,
+				.timestamp = t,
+				.velocity = f == 0 ? 0.0 : dx * step / FRAME_SECONDS,
+			};
+			touch_frame_add(&frame, &contact);
+		}
+		binding = recognizer_feed(&device->gesture, config, &frame, modifier);
+	}
+	synthetic_until = t0 + fed * FRAME_SECONDS;
+	touch_frame_init(&frame, CONTROL_DEVICE, synthetic_until);
+	recognizer_feed(&device->gesture, config, &frame, modifier);
+	pthread_mutex_unlock(&device->lock);
+
+	uint64_t recognized = stats_now_ns();
+	if (binding)
+		server->hooks.run(device, config, binding, start);
+
+	cJSON* reply = success();
+	cJSON_AddNumberToObject(reply, "frames", fed);
+	add_timing(reply, binding, start, recognized, stats_now_ns());
+	release_config(server, config);
+	return reply;
+}
+
+static cJSON* handle(const control_server* server, char* line)
+{
+	char* args[CONTROL_ARGS];
+	int argc = 0;
+	char* save = NULL;
+	for (char* token = strtok_r(line, " \t\r", &save); token; token = strtok_r(NULL, " \t\r", &save)) {
+		if (argc == CONTROL_ARGS)
+			return failure("too many arguments");
+		args[argc++] = token;
+	}
+	if (argc == 0)
+		return failure("empty request");
+
+	const char* verb = args[0];
+	if (strcmp(verb, "status") == 0)
+		return status(server);
+	if (strcmp(verb, "config") == 0) {
+		cJSON* reply = success();
+		const Config* config = server->hooks.config();
+		cJSON_AddItemToObject(reply, "config", config_describe(config));
+		release_config(server, config);
+		return reply;
+	}
+	if (strcmp(verb, "stats") == 0)
+		return stats();
+	if (strcmp(verb, "reload") == 0) {
+		if (!server->hooks.reload)
+			return failure("reload is not supported here");
+		return server->hooks.reload() ? success() : failure("the config did not load, keeping the old one");
+	}
+	if (strcmp(verb, "refresh") == 0) {
+		executor_forget_workspaces();
+		return success();
+	}
+	if (strcmp(verb, "dump") == 0)
+		return dump(argc > 1 ? args[1] : NULL);
+	if (strcmp(verb, "swipe") == 0)
+		return swipe(server, args, argc);
+	if (strcmp(verb, "run") == 0)
+		return run(server, args, argc);
+	return failure("unknown request");
+}
+
+static bool reply_to(int conn, cJSON* reply)
+{
+	char* json = cJSON_PrintUnformatted(reply);
+	cJSON_Delete(reply);
+	if (!json)
+		return false;
+
+	size_t len = strlen(json);
+	/* the terminator's byte carries the newline */
+	json[len++] = '\n';
+	bool ok = true;
+	for (size_t written = 0; ok && written < len;) {
+		ssize_t n = write(conn, json + written, len - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		ok = n > 0;
+		written += ok ? (size_t)n : 0;
+	}
+	cJSON_free(json);
+	return ok;
+}
+
+static void* connection_thread(void* arg)
+{
+	control_connection* connection = arg;
+	int conn = connection->conn;
+	char buf[CONTROL_LINE];
+	size_t len = 0;
+
+	for (;;) {
+		ssize_t n = read(conn, buf + len, sizeof(buf) - 1 - len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+		buf[len] = '\0';
+
+		char* line = buf;
+		bool open = true;
+		for (char* end; open && (end = strchr(line, '\n'));) {
+			*end = '\0';
+			open = reply_to(conn, handle(connection->server, line));
+			line = end + 1;
+		}
+		len -= line - buf;
+		memmove(buf, line, len);
+		if (!open || (len == sizeof(buf) - 1 && !reply_to(conn, failure("request too long"))))
+			break;
+		if (len == sizeof(buf) - 1)
+			len = 0;
+	}
+
+	close(conn);
+	free(connection);
+	return NULL;
+}
+
+static void* accept_thread(void* arg)
+{
+	control_server* server = arg;
+
+	for (;;) {
+		int conn = accept(server->fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			log_error("Control: accept failed: %s", strerror(errno));
+			break;
+		}
+
+		/* a connection of its own thread, so a slow command or an idle
+		 * client never holds up the next one */
+		control_connection* connection = malloc(sizeof(control_connection));
+		pthread_t thread;
+		if (!connection) {
+			close(conn);
+			continue;
+		}
+		connection->server = server;
+		connection->conn = conn;
+		if (pthread_create(&thread, NULL, connection_thread, connection) != 0) {
+			close(conn);
+			free(connection);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	close(server->fd);
+	return NULL;
+}
+
+char* control_socket_path(void)
+{
+	const char* user = getenv("USER");
+	if (!user)
+		user = "unknown";
+
+	size_t len = snprintf(NULL, 0, "/tmp/aerospace-swipe-%s.control.sock", user);
+	char* path = malloc(len + 1);
+	if (path)
+		snprintf(path, len + 1, "/tmp/aerospace-swipe-%s.control.sock", user);
+	return path;
+}
+
+bool control_server_start(const char* path, const control_hooks* hooks)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		log_error("Control: socket path too long: %s", path);
+		return false;
+	}
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	/* lives as long as the process, connections point at it */
+	control_server* server = malloc(sizeof(control_server));
+	if (!server)
+		return false;
+	server->hooks = *hooks;
+	server->started_ns = stats_now_ns();
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->fd < 0) {
+		log_error("Control: failed to create socket: %s", strerror(errno));
+		free(server);
+		return false;
+	}
+
+	/* the same single instance rule as the stats socket */
+	unlink(path);
+	/* anyone who connects can fire bindings; connects fail until listen, so
+	 * the mode is ours before the first one can land */
+	if (bind(server->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || chmod(path, 0600) < 0
+		|| listen(server->fd, 8) < 0) {
+		log_error("Control: failed to listen on %s: %s", path, strerror(errno));
+		close(server->fd);
+		free(server);
+		return false;
+	}
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, accept_thread, server) != 0) {
+		log_error("Control: failed to start server thread.");
+		close(server->fd);
+		free(server);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "cJSON.h"
+#include "config.h"
+#include "devices.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The daemon's control socket. A client writes requests, one per line, and
+ * reads one line of JSON back for each; a connection may carry any number
+ * of them, so a load test can keep one open.
+ *
+ *   status                        pid, uptime and devices, plus the host's own
+ *   config                        the running config, see config_describe
+ *   stats                         the stats snapshot
+ *   reload                        re-read the config file
+ *   refresh                       drop the cached workspace listings
+ *   dump [path]                   write the flight recorder
+ *   swipe fingers direction [modifier]
+ *                                 synthesize the frames of a swipe and feed
+ *                                 them to a recognizer of their own, running
+ *                                 what it triggers
+ *   run fingers direction [modifier]
+ *                                 run the bound command as if recognized
+ *
+ * Every reply has "ok", and "error" when it is false. Injected commands run
+ * on the connection's thread through the host's executor, so their replies
+ * carry the time the command took. */
+
+/* the trackpad synthesized swipes come from */
+#define CONTROL_DEVICE UINT64_MAX
+
+typedef struct {
+	/* Pin the live config, and unpin it; release may be NULL when the
+	 * config never changes. */
+	const Config* (*config)(void);
+	void (*release)(const Config* config);
+	/* NULL when the host cannot reload */
+	bool (*reload)(void);
+	/* Run a binding of config triggered at event_ns the way the host's
+	 * gesture path would, returning when it is done. */
+	void (*run)(gesture_device* device, const Config* config, const Binding* binding, uint64_t event_ns);
+	/* Add the host's own fields to a status reply; may be NULL. */
+	void (*status)(cJSON* reply);
+} control_hooks;
+
+/* /tmp/aerospace-swipe-$USER.control.sock; the caller frees it. */
+char* control_socket_path(void);
+
+bool control_server_start(const char* path, const control_hooks* hooks);
@@ -0,0 +1,101 @@
+#include "devices.h"
+#include "log.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static _Atomic(gesture_device*) devices[MAX_DEVICES];
+static pthread_mutex_t registry = PTHREAD_MUTEX_INITIALIZER;
+static device_haptics_opener opener = NULL;
+
+void devices_init(device_haptics_opener open_haptics)
+{
+	opener = open_haptics;
+}
+
+static gesture_device* find(uint64_t id, int* free_slot)
+{
+	*free_slot = -1;
+	for (int i = 0; i < MAX_DEVICES; ++i) {
+		gesture_device* device = atomic_load_explicit(&devices[i], memory_order_acquire);
+		if (!device) {
+			*free_slot = i;
+			return NULL;
+		}
+		if (device->id == id)
+			return device;
+	}
+	return NULL;
+}
+
+gesture_device* devices_get(uint64_t id)
+{
+	int slot;
+	gesture_device* device = find(id, &slot);
+	if (device)
+		return device;
+
+	/* slots fill in order and are never freed, so a rescan under the lock
+	 * sees every device another thread may have added meanwhile */
+	pthread_mutex_lock(&registry);
+	device = find(id, &slot);
+	if (!device && slot >= 0) {
+		device = calloc(1, sizeof(gesture_device));
+		if (device) {
+			device->id = id;
+			pthread_mutex_init(&device->lock, NULL);
+			recognizer_init(&device->gesture);
+			device->haptics = opener ? opener(id) : NULL;
+			atomic_store_explicit(&devices[slot], device, memory_order_release);
+			log_info("New input device %llx.", (unsigned long long)id);
+		}
+	} else if (!device) {
+		log_warn("Ignoring input device %llx: already tracking %d devices.", (unsigned long long)id,
+			MAX_DEVICES);
+	}
+	pthread_mutex_unlock(&registry);
+	return device;
+}
+
+void devices_stop(haptic_queue* shared)
+{
+	pthread_mutex_lock(&registry);
+	for (int i = 0; i < MAX_DEVICES; ++i) {
+		gesture_device* device = atomic_load_explicit(&devices[i], memory_order_acquire);
+		if (!device)
+			break;
+		if (device->haptics && device->haptics != shared)
+			haptic_queue_stop(device->haptics);
+		device->haptics = NULL;
+	}
+	pthread_mutex_unlock(&registry);
+}
+
+int devices_save(device_state* states, int max)
+{
+	int count = 0;
+	for (int i = 0; i < MAX_DEVICES && count < max; ++i) {
+		gesture_device* device = atomic_load_explicit(&devices[i], memory_order_acquire);
+		if (!device)
+			break;
+		pthread_mutex_lock(&device->lock);
+		states[count].id = device->id;
+		states[count].gesture = device->gesture;
+		pthread_mutex_unlock(&device->lock);
+		count++;
+	}
+	return count;
+}
+
+bool devices_restore(const device_state* state)
+{
+	gesture_device* device = devices_get(state->id);
+	if (!device)
+		return false;
+	pthread_mutex_lock(&device->lock);
+	bool quiet = device->gesture.quiet;
+	device->gesture = state->gesture;
+	/* a setting of this process, not part of the gesture */
+	device->gesture.quiet = quiet;
+	pthread_mutex_unlock(&device->lock);
+	return true;
+}
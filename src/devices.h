@@ -0,0 +1,49 @@
+#pragma once
+#include "haptic_queue.h"
+#include "recognizer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Gesture state per input device, so two trackpads never share a centroid
+ * and frames from one never wait on the other's lock.
+ *
+ * Devices are created on their first frame and live for the rest of the
+ * process; lookups of known devices are lock-free. */
+
+#define MAX_DEVICES 8
+
+typedef struct {
+	uint64_t id;
+	pthread_mutex_t lock; /* held while a frame of this device is recognized */
+	recognizer gesture; /* guarded by lock */
+	haptic_queue* haptics; /* may be shared with other devices, or NULL */
+} gesture_device;
+
+/* A device's gesture state, as handed to a restarted instance. */
+typedef struct {
+	uint64_t id;
+	recognizer gesture;
+} device_state;
+
+/* Opens the haptics of a newly seen device; NULL for none. Called at most
+ * once per device, under the registry lock. */
+typedef haptic_queue* (*device_haptics_opener)(uint64_t id);
+
+void devices_init(device_haptics_opener open_haptics);
+
+/* The device with this id, created if new. NULL once MAX_DEVICES are in use
+ * or when out of memory; the frame should then be dropped. */
+gesture_device* devices_get(uint64_t id);
+
+/* Stop the haptic queues the devices own, for shutdown. shared is a queue
+ * handed to several devices; it is left for the caller to stop. */
+void devices_stop(haptic_queue* shared);
+
+/* Copy out the state of up to max devices, each under its lock; returns
+ * how many were copied. */
+int devices_save(device_state* states, int max);
+
+/* Take a saved state over, creating its device if new. False when the
+ * device cannot be created. */
+bool devices_restore(const device_state* state);
@@ -6,6 +6,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "recognizer.h"
+
 extern const char* get_name_for_pid(uint64_t pid);
 extern char* string_copy(char* s);
 
@@ -15,26 +17,13 @@ struct event_tap {
 	CGEventMask mask;
 };
 
-typedef struct {
-	double x;
-	double y;
-	int phase;
-	double timestamp;
-	double velocity;
-} touch;
-
-typedef struct {
-	double x;
-	double y;
-	double timestamp;
-} touch_state;
-
 @interface TouchConverter : NSObject
+/* Call once per gesture event, before converting its touches. */
++ (void)next_frame;
 + (touch)convert_nstouch:(id)nsTouch;
 @end
 
 struct event_tap g_event_tap;
-static CFMutableDictionaryRef touchStates;
 
 bool event_tap_enabled(struct event_tap* event_tap);
 bool event_tap_begin(struct event_tap* event_tap, CGEventRef (*reference)(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* userdata));
@@ -1,4 +1,5 @@
 #import "event_tap.h"
+#include "contact_table.h"
 #import <AppKit/AppKit.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <objc/message.h>
@@ -6,55 +7,33 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* only touched from the event tap callback on the main thread */
+static contact_table contacts;
+static bool contacts_ready = false;
+
 @implementation TouchConverter
 
++ (void)next_frame
+{
+	if (!contacts_ready) {
+		contact_table_init(&contacts);
+		contacts_ready = true;
+	}
+	contact_table_next_frame(&contacts);
+}
+
 + (touch)convert_nstouch:(id)nsTouch
 {
 	NSTouch* touchObj = (NSTouch*)nsTouch;
-	touch nt;
-
 	CGPoint pos = [touchObj normalizedPosition];
-	nt.x = pos.x;
-	nt.y = pos.y;
-
-	nt.phase = (int)[touchObj phase];
-	nt.timestamp = [[touchObj valueForKey:@"timestamp"] doubleValue];
+	double timestamp = [[touchObj valueForKey:@"timestamp"] doubleValue];
 
-	id touchIdentity = [touchObj identity];
-
-	if (!touchStates) {
-		touchStates = CFDictionaryCreateMutable(NULL, 0,
-			&kCFTypeDictionaryKeyCallBacks,
-			NULL);
-	}
-
-	double velocity_x = 0.0;
-	touch_state* state = (touch_state*)CFDictionaryGetValue(touchStates, (__bridge const void*)(touchIdentity));
-	if (state) {
-		double dt = nt.timestamp - state->timestamp;
-		if (dt > 0)
-			velocity_x = (nt.x - state->x) / dt;
-		state->x = nt.x;
-		state->y = nt.y;
-		state->timestamp = nt.timestamp;
-	} else {
-		state = malloc(sizeof(touch_state));
-		if (state) {
-			state->x = nt.x;
-			state->y = nt.y;
-			state->timestamp = nt.timestamp;
-			CFDictionarySetValue(touchStates, (__bridge const void*)(touchIdentity), state);
-		}
-	}
-	nt.velocity = velocity_x;
-
-	if (nt.phase == 8) {
-		CFDictionaryRemoveValue(touchStates, (__bridge const void*)(touchIdentity));
-		if (state)
-			free(state);
-	}
+	/* identities are equal by isEqual:, not by pointer, so key on the hash */
+	uint64_t key = (uint64_t)[[touchObj identity] hash];
+	if (!contacts_ready)
+		[TouchConverter next_frame];
 
-	return nt;
+	return contact_table_convert(&contacts, key, pos.x, pos.y, (int)[touchObj phase], timestamp);
 }
 
 @end
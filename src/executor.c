@@ -0,0 +1,179 @@
+#include "executor.h"
+#include "flight_recorder.h"
+#include "log.h"
+#include "stats.h"
+#include "workspace_cache.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* devices recognize in parallel but share one aerospace connection, whose
+ * requests and replies must not interleave */
+static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;
+/* guarded by client_lock */
+static bool paused;
+/* guarded by client_lock */
+static workspace_cache cache;
+static bool cache_ready;
+
+void executor_pause(void)
+{
+	pthread_mutex_lock(&client_lock);
+	paused = true;
+	pthread_mutex_unlock(&client_lock);
+}
+
+void executor_resume(void)
+{
+	pthread_mutex_lock(&client_lock);
+	paused = false;
+	pthread_mutex_unlock(&client_lock);
+}
+
+void executor_forget_workspaces(void)
+{
+	pthread_mutex_lock(&client_lock);
+	if (cache_ready)
+		workspace_cache_forget(&cache);
+	pthread_mutex_unlock(&client_lock);
+}
+
+/* The focused monitor's listing with its focus set, NULL when aerospace
+ * could not tell. Which workspaces are empty changes with every window
+ * moved and only a listing tells, so skip_empty lists the focused monitor
+ * each time, keeping the listing per monitor so alternating monitors does
+ * not rebuild it. Otherwise only the focus is asked for and the monitor's
+ * cached listing is used while it holds the focused workspace; every
+ * command but a local switch, and a switch that fails, drops the cache. */
+static workspace_table* focused_workspaces(Aerospace* client, bool non_empty)
+{
+	if (!cache_ready) {
+		workspace_cache_init(&cache);
+		cache_ready = true;
+	}
+
+	uint64_t now = stats_now_ns();
+	workspace_cache_entry* entry;
+	if (non_empty) {
+		entry = workspace_cache_entry_for(&cache, cache.focused_monitor);
+		if (!aerospace_list_workspaces(client, WORKSPACES_FOCUSED_MONITOR, true, &entry->table))
+			return NULL;
+		stats_count(COUNTER_WORKSPACE_LISTINGS);
+		entry = workspace_cache_listed(&cache, entry, true, now);
+	} else {
+		if (!aerospace_focused_workspace(client, &cache.focus) || cache.focus.monitor < 0)
+			return NULL;
+		const char* name = workspace_table_name(&cache.focus, 0);
+		entry = workspace_cache_entry_for(&cache, cache.focus.monitor);
+		if (workspace_cache_use(entry, false, name, now)) {
+			stats_count(COUNTER_WORKSPACE_HITS);
+		} else {
+			if (!aerospace_list_workspaces(client, cache.focus.monitor, false, &entry->table))
+				return NULL;
+			stats_count(COUNTER_WORKSPACE_LISTINGS);
+			entry = workspace_cache_listed(&cache, entry, false, now);
+			/* the focus may have moved in between; the listing has the
+			 * whole monitor either way */
+			entry->table.focused = workspace_table_find(&entry->table, name);
+		}
+	}
+	cache.focused_monitor = entry->monitor;
+	return &entry->table;
+}
+
+void execute_binding(Aerospace* client, haptic_queue* haptics, const Config* config,
+	const Binding* binding, uint64_t event_ns)
+{
+	stats_count(COUNTER_TRIGGERS);
+	if (!client) {
+		uint64_t done = stats_now_ns();
+		stats_record(STAGE_SWIPE, done > event_ns ? done - event_ns : 0);
+		stats_phase_done(PHASE_FIRST_COMMAND);
+		log_info("Would run '%s'.", binding->label);
+		if (haptics && config->haptic && config->haptic_policy == HAPTIC_ON_SWITCH)
+			haptic_queue_post(haptics, 3);
+		return;
+	}
+
+	pthread_mutex_lock(&client_lock);
+	if (paused) {
+		pthread_mutex_unlock(&client_lock);
+		log_info("Dropped '%s', the connection is being handed over.", binding->label);
+		stats_count(COUNTER_DROPS);
+		return;
+	}
+	workspace_table* workspaces = NULL;
+	if (binding->workspace_list) {
+		uint64_t start = stats_now_ns();
+		flight_record_event(FR_COMMAND, 0, FR_COMMAND_LIST, 0, 0, 0);
+		workspaces = focused_workspaces(client, config->skip_empty);
+		uint64_t elapsed = stats_now_ns() - start;
+		stats_record(STAGE_LIST_QUERY, elapsed);
+		flight_record_event(FR_REPLY, 0, FR_COMMAND_LIST | (workspaces ? 0 : FR_FAILED), 0, 0, elapsed / 1e3f);
+		if (!workspaces) {
+			pthread_mutex_unlock(&client_lock);
+			log_error("Unable to retrieve workspace list.");
+			stats_count(COUNTER_ERRORS);
+			return;
+		}
+	}
+
+	/* next and prev resolve here and go out as "workspace <name>"; when the
+	 * focused workspace is not in the listing (an empty one with skip_empty)
+	 * aerospace gets the listing and decides */
+	bool local = binding->step && workspaces->focused >= 0;
+	int target = local ? workspace_table_step(workspaces, binding->step, binding->wrap) : -1;
+	if (local && target < 0) {
+		pthread_mutex_unlock(&client_lock);
+		log_info("Nothing to do for '%s', already on the %s workspace.", binding->label,
+			binding->step > 0 ? "last" : "first");
+		return;
+	}
+	char* listing = NULL;
+	if (binding->workspace_list && !local && !(listing = workspace_table_listing(workspaces))) {
+		pthread_mutex_unlock(&client_lock);
+		log_error("Unable to retrieve workspace list.");
+		stats_count(COUNTER_ERRORS);
+		return;
+	}
+
+	uint64_t start = stats_now_ns();
+	flight_record_event(FR_COMMAND, 0, FR_COMMAND_RUN, 0, 0, 0);
+	char* result = local ? aerospace_focus_workspace(client, workspace_table_name(workspaces, target))
+			     : aerospace_execute(client, &binding->request, listing);
+	if (local && result) {
+		/* the listing was stale, e.g. the target is gone: list again and
+		 * try once more */
+		workspace_cache_forget(&cache);
+		workspaces = focused_workspaces(client, config->skip_empty);
+		target = workspaces && workspaces->focused >= 0
+			? workspace_table_step(workspaces, binding->step, binding->wrap)
+			: -1;
+		if (target >= 0) {
+			free(result);
+			result = aerospace_focus_workspace(client, workspace_table_name(workspaces, target));
+		}
+	}
+	/* the workspace stays on its monitor, so the listing holds; any other
+	 * command may create, remove or move workspaces */
+	if (local && !result)
+		workspaces->focused = target;
+	else if (cache_ready)
+		workspace_cache_forget(&cache);
+	pthread_mutex_unlock(&client_lock);
+	free(listing);
+	uint64_t done = stats_now_ns();
+	stats_record(STAGE_SWITCH_COMMAND, done - start);
+	flight_record_event(FR_REPLY, 0, FR_COMMAND_RUN | (result ? FR_FAILED : 0), 0, 0, (done - start) / 1e3f);
+	if (result) {
+		log_error("Failed to run '%s': %s", binding->label, result);
+		stats_count(COUNTER_ERRORS);
+		free(result);
+	} else {
+		stats_record(STAGE_SWIPE, done > event_ns ? done - event_ns : 0);
+		stats_phase_done(PHASE_FIRST_COMMAND);
+		log_info("Ran '%s' successfully.", binding->label);
+		if (haptics && config->haptic && config->haptic_policy == HAPTIC_ON_SWITCH)
+			haptic_queue_post(haptics, 3);
+	}
+}
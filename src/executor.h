@@ -0,0 +1,26 @@
+#pragma once
+#include "aerospace.h"
+#include "config.h"
+#include "haptic_queue.h"
+#include <stdint.h>
+
+/* Run a triggered binding: fetch the workspace list it needs, resolve
+ * next/prev against it, send the command, confirm with a haptic and account for it all in stats and the
+ * flight recorder. event_ns is when the triggering input happened, on the
+ * stats_now_ns clock.
+ *
+ * Without a client nothing is sent and the binding only counts as run,
+ * which lets input harnesses time the pipeline without aerospace. haptics
+ * may be NULL. Safe to call from several threads; requests to the client
+ * are serialized. */
+void execute_binding(Aerospace* client, haptic_queue* haptics, const Config* config,
+	const Binding* binding, uint64_t event_ns);
+
+/* Wait for the command in flight and drop every binding after it until
+ * executor_resume, so the client can be handed to another process. */
+void executor_pause(void);
+void executor_resume(void);
+
+/* Drop the cached workspace listings, e.g. when displays come or go or a
+ * workspace was moved to another monitor. */
+void executor_forget_workspaces(void);
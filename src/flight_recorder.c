@@ -0,0 +1,154 @@
+#include "flight_recorder.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+/* must be a power of two; 32 bytes per slot, so 256KB, or roughly the last
+ * minute of continuous swiping at trackpad frame rates */
+#define FLIGHT_RECORDS 8192
+
+/* Each slot is a tiny seqlock: the sequence is cleared before the record is
+ * written and set to its ring position + 1 afterwards, so a dump can detect
+ * and skip slots caught mid-write without ever blocking a writer. */
+typedef struct {
+	_Atomic uint64_t sequence;
+	flight_record record;
+} flight_slot;
+
+static flight_slot ring[FLIGHT_RECORDS];
+static _Atomic uint64_t head = 0;
+
+/* Records keep raw clock ticks and the dump converts them, so the hot path
+ * pays for a counter read instead of a full clock_gettime. */
+static inline uint64_t now_ticks(void)
+{
+#ifdef __APPLE__
+	return mach_absolute_time();
+#else
+	return stats_now_ns();
+#endif
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks)
+{
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return ticks * timebase.numer / timebase.denom;
+#else
+	return ticks;
+#endif
+}
+
+static const char* const type_names[FR_TYPE_COUNT] = {
+	"frame", "state", "trigger", "command", "reply", "config"
+};
+static const char* const state_names[FR_STATE_COUNT] = {
+	"begin", "reset-fingers", "reset-cooldown", "restart", "vertical", "grace"
+};
+
+void flight_record_event(fr_type type, uint8_t fingers, uint16_t detail, float x,
+	float y, float value)
+{
+	uint64_t position = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed);
+	flight_slot* slot = &ring[position & (FLIGHT_RECORDS - 1)];
+
+	atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	slot->record.time_ns = now_ticks();
+	slot->record.type = (uint8_t)type;
+	slot->record.fingers = fingers;
+	slot->record.detail = detail;
+	slot->record.x = x;
+	slot->record.y = y;
+	slot->record.value = value;
+
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+bool flight_recorder_dump(const char* path)
+{
+	flight_record* records = malloc(sizeof(flight_record) * FLIGHT_RECORDS);
+	if (!records)
+		return false;
+
+	uint64_t end = atomic_load_explicit(&head, memory_order_acquire);
+	uint64_t begin = end > FLIGHT_RECORDS ? end - FLIGHT_RECORDS : 0;
+	uint32_t count = 0;
+
+	for (uint64_t position = begin; position < end; ++position) {
+		flight_slot* slot = &ring[position & (FLIGHT_RECORDS - 1)];
+		uint64_t before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (before != position + 1)
+			continue; /* being written, or already overwritten by a newer lap */
+
+		flight_record copy;
+		memcpy(&copy, &slot->record, sizeof(copy));
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != before)
+			continue;
+		copy.time_ns = ticks_to_ns(copy.time_ns);
+		records[count++] = copy;
+	}
+
+	flight_dump_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SWFR", 4);
+	header.version = FLIGHT_DUMP_VERSION;
+	header.record_size = sizeof(flight_record);
+	header.count = count;
+	header.dumped_ns = stats_now_ns();
+
+	/* write to a temporary file and rename so readers never see half a dump */
+	char tmp[1024];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	int fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+	if (fd < 0) {
+		free(records);
+		return false;
+	}
+
+	size_t len = sizeof(flight_record) * count;
+	bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+		&& write(fd, records, len) == (ssize_t)len;
+	ok = (close(fd) == 0) && ok;
+	free(records);
+
+	if (!ok || rename(tmp, path) != 0) {
+		unlink(tmp);
+		return false;
+	}
+	return true;
+}
+
+char* flight_recorder_path(void)
+{
+	const char* user = getenv("USER");
+	if (!user)
+		user = "unknown";
+
+	size_t len = snprintf(NULL, 0, "/tmp/aerospace-swipe-%s.flight", user);
+	char* path = malloc(len + 1);
+	if (path)
+		snprintf(path, len + 1, "/tmp/aerospace-swipe-%s.flight", user);
+	return path;
+}
+
+const char* flight_record_type_name(uint8_t type)
+{
+	return type < FR_TYPE_COUNT ? type_names[type] : "unknown";
+}
+
+const char* flight_record_state_name(uint16_t state)
+{
+	return state < FR_STATE_COUNT ? state_names[state] : "unknown";
+}
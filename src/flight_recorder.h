@@ -0,0 +1,70 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Always-on black box: the most recent gesture and command events, kept as
+ * compact binary records in a fixed lock-free ring and dumped on demand. */
+
+typedef enum {
+	FR_FRAME, /* fingers, centroid x/y, value = mean x velocity */
+	FR_STATE, /* detail = fr_state, x/y = delta from gesture start */
+	FR_TRIGGER, /* detail = direction | FR_BY_VELOCITY/PREDICTION, value = mean x velocity */
+	FR_COMMAND, /* detail = fr_command, sent to aerospace */
+	FR_REPLY, /* detail = fr_command | FR_FAILED, value = round trip in us */
+	FR_CONFIG, /* detail = 0 reloaded, FR_FAILED rejected */
+	FR_TYPE_COUNT
+} fr_type;
+
+typedef enum {
+	FR_STATE_BEGIN,
+	FR_STATE_RESET_FINGERS, /* finger count without a binding */
+	FR_STATE_RESET_COOLDOWN,
+	FR_STATE_RESTART, /* finger count changed mid gesture */
+	FR_STATE_VERTICAL, /* ignored, mostly vertical movement */
+	FR_STATE_GRACE, /* finger count changed, gesture kept for the grace window */
+	FR_STATE_COUNT
+} fr_state;
+
+typedef enum {
+	FR_COMMAND_LIST,
+	FR_COMMAND_RUN
+} fr_command;
+
+#define FR_BY_VELOCITY 0x100
+#define FR_BY_PREDICTION 0x200
+#define FR_FAILED 0x8000
+
+typedef struct {
+	uint64_t time_ns;
+	uint8_t type;
+	uint8_t fingers;
+	uint16_t detail;
+	float x;
+	float y;
+	float value;
+} flight_record;
+
+/* Header of a dump file, followed by count records oldest first. */
+typedef struct {
+	char magic[4]; /* "SWFR" */
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t count;
+	uint32_t reserved;
+	uint64_t dumped_ns;
+} flight_dump_header;
+
+#define FLIGHT_DUMP_VERSION 1
+
+/* A handful of plain stores and one atomic add; safe from any thread. */
+void flight_record_event(fr_type type, uint8_t fingers, uint16_t detail, float x,
+	float y, float value);
+
+/* Write the ring to path. Records being written concurrently are skipped. */
+bool flight_recorder_dump(const char* path);
+
+/* /tmp/aerospace-swipe-$USER.flight; the caller frees it. */
+char* flight_recorder_path(void);
+
+const char* flight_record_type_name(uint8_t type);
+const char* flight_record_state_name(uint16_t state);
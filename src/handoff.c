@@ -0,0 +1,370 @@
+#include "handoff.h"
+#include "log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define HANDOFF_MAGIC 0x68617773u /* "swah" */
+#define HANDOFF_VERSION 2
+/* how long the old instance waits for the new one to confirm */
+#define HANDOFF_CONFIRM_SECONDS 5
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t has_fd;
+	uint32_t state_size; /* sizeof(device_state) on the sending side */
+	uint32_t device_count;
+	uint64_t layout; /* layout_fingerprint() on the sending side */
+} handoff_header;
+
+typedef struct {
+	int fd;
+	handoff_hooks hooks;
+} handoff_server;
+
+#define FIELD(type, field) offsetof(type, field), sizeof(((type*)0)->field)
+
+/* Offset and size of every field of what device_state holds. Two builds
+ * agreeing on all of them can copy each other's gesture state as is. */
+static const uint32_t layout[] = {
+	sizeof(device_state),
+	FIELD(device_state, id),
+	FIELD(device_state, gesture),
+	sizeof(recognizer),
+	FIELD(recognizer, swiping),
+	FIELD(recognizer, fingers),
+	FIELD(recognizer, ids),
+	FIELD(recognizer, origin_x),
+	FIELD(recognizer, origin_y),
+	FIELD(recognizer, tracked),
+	FIELD(recognizer, grace_since),
+	FIELD(recognizer, last_swipe_time),
+	FIELD(recognizer, history_t),
+	FIELD(recognizer, history_x),
+	FIELD(recognizer, history_count),
+	FIELD(recognizer, history_next),
+	FIELD(recognizer, direction),
+	FIELD(recognizer, predicted),
+	FIELD(recognizer, quiet),
+	sizeof(touch_frame),
+	FIELD(touch_frame, x),
+	FIELD(touch_frame, y),
+	FIELD(touch_frame, velocity),
+	FIELD(touch_frame, timestamp),
+	FIELD(touch_frame, device),
+	FIELD(touch_frame, count),
+	FIELD(touch_frame, phase),
+	FIELD(touch_frame, id),
+};
+
+/* FNV-1a over the layout table */
+static uint64_t layout_fingerprint(void)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(layout) / sizeof(layout[0]); ++i) {
+		hash ^= layout[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool write_full(int fd, const void* buf, size_t len)
+{
+	const char* p = buf;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool read_full(int fd, void* buf, size_t len)
+{
+	char* p = buf;
+	while (len > 0) {
+		ssize_t n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* The five bytes of "take\n" or "done\n". */
+static bool expect(int fd, const char* word)
+{
+	char buf[5];
+	return read_full(fd, buf, sizeof(buf)) && memcmp(buf, word, sizeof(buf)) == 0;
+}
+
+static bool send_state(int conn, const handoff_state* state)
+{
+	handoff_header header = {
+		.magic = HANDOFF_MAGIC,
+		.version = HANDOFF_VERSION,
+		.has_fd = state->aerospace_fd >= 0,
+		.state_size = sizeof(device_state),
+		.device_count = (uint32_t)state->device_count,
+		.layout = layout_fingerprint(),
+	};
+	struct iovec iov = { &header, sizeof(header) };
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (header.has_fd) {
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &state->aerospace_fd, sizeof(int));
+	}
+
+	ssize_t sent;
+	do
+		sent = sendmsg(conn, &msg, 0);
+	while (sent < 0 && errno == EINTR);
+	/* the fd went with the first byte; the rest is plain data */
+	if (sent <= 0 || !write_full(conn, (char*)&header + sent, sizeof(header) - sent))
+		return false;
+	return write_full(conn, state->devices, sizeof(device_state) * state->device_count);
+}
+
+/* One exchange on conn; true once the new instance has confirmed. */
+static bool hand_over(int conn, const handoff_hooks* hooks)
+{
+	/* a new instance connects early and asks once it is ready */
+	if (!expect(conn, "take\n"))
+		return false;
+
+	handoff_state state;
+	memset(&state, 0, sizeof(state));
+	state.aerospace_fd = -1;
+	if (!hooks->release(&state)) {
+		log_warn("Refused a handoff.");
+		return false;
+	}
+
+	struct timeval timeout = { HANDOFF_CONFIRM_SECONDS, 0 };
+	setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (!send_state(conn, &state) || !expect(conn, "done\n")) {
+		log_warn("Handoff not confirmed, carrying on.");
+		hooks->resume();
+		return false;
+	}
+	log_info("Handed over %d device(s)%s.", state.device_count,
+		state.aerospace_fd >= 0 ? " and the aerospace connection" : "");
+	return true;
+}
+
+static void* serve_thread(void* arg)
+{
+	handoff_server* server = arg;
+
+	for (;;) {
+		int conn = accept(server->fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			log_error("Handoff: accept failed: %s", strerror(errno));
+			break;
+		}
+		bool handed = hand_over(conn, &server->hooks);
+		close(conn);
+		if (handed) {
+			server->hooks.finish();
+			break;
+		}
+	}
+
+	close(server->fd);
+	free(server);
+	return NULL;
+}
+
+char* handoff_socket_path(void)
+{
+	const char* user = getenv("USER");
+	if (!user)
+		user = "unknown";
+
+	size_t len = snprintf(NULL, 0, "/tmp/aerospace-swipe-%s.handoff.sock", user);
+	char* path = malloc(len + 1);
+	if (path)
+		snprintf(path, len + 1, "/tmp/aerospace-swipe-%s.handoff.sock", user);
+	return path;
+}
+
+static bool socket_address(const char* path, struct sockaddr_un* addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		log_error("Handoff: socket path too long: %s", path);
+		return false;
+	}
+	strncpy(addr->sun_path, path, sizeof(addr->sun_path) - 1);
+	return true;
+}
+
+bool handoff_serve(const char* path, const handoff_hooks* hooks)
+{
+	struct sockaddr_un addr;
+	if (!socket_address(path, &addr))
+		return false;
+
+	handoff_server* server = malloc(sizeof(handoff_server));
+	if (!server)
+		return false;
+	server->hooks = *hooks;
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->fd < 0) {
+		log_error("Handoff: failed to create socket: %s", strerror(errno));
+		free(server);
+		return false;
+	}
+
+	/* a predecessor that handed over to us may still be on its way out;
+	 * its socket is ours to replace */
+	unlink(path);
+	/* whoever connects gets our devices and the aerospace fd, so narrow the
+	 * mode before anyone can */
+	if (bind(server->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || chmod(path, 0600) < 0
+		|| listen(server->fd, 1) < 0) {
+		log_error("Handoff: failed to listen on %s: %s", path, strerror(errno));
+		close(server->fd);
+		free(server);
+		return false;
+	}
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, serve_thread, server) != 0) {
+		log_error("Handoff: failed to start server thread.");
+		close(server->fd);
+		free(server);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
+
+int handoff_connect(const char* path)
+{
+	struct sockaddr_un addr;
+	if (!socket_address(path, &addr))
+		return -1;
+	int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (conn < 0)
+		return -1;
+	if (connect(conn, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		close(conn);
+		return -1;
+	}
+	return conn;
+}
+
+/* Reads the header, picking up the fd that came with it. */
+static bool receive_header(int conn, handoff_header* header, int* fd)
+{
+	struct iovec iov = { header, sizeof(*header) };
+	union {
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t got;
+	do
+		got = recvmsg(conn, &msg, 0);
+	while (got < 0 && errno == EINTR);
+	if (got <= 0)
+		return false;
+
+	*fd = -1;
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+	return read_full(conn, (char*)header + got, sizeof(*header) - got);
+}
+
+bool handoff_take(int conn, handoff_state* state)
+{
+	memset(state, 0, sizeof(*state));
+	state->aerospace_fd = -1;
+
+	handoff_header header;
+	int fd = -1;
+	if (!write_full(conn, "take\n", 5) || !receive_header(conn, &header, &fd) || header.magic != HANDOFF_MAGIC
+		|| header.version != HANDOFF_VERSION || header.device_count > MAX_DEVICES) {
+		log_error("Handoff: no usable answer from the running instance.");
+		if (fd >= 0)
+			close(fd);
+		close(conn);
+		return false;
+	}
+	state->aerospace_fd = fd;
+
+	bool same_layout = header.layout == layout_fingerprint() && header.state_size == sizeof(device_state);
+	for (uint32_t i = 0; i < header.device_count; ++i) {
+		char skipped[512];
+		bool ok = true;
+		if (same_layout) {
+			ok = read_full(conn, &state->devices[i], sizeof(device_state));
+		} else {
+			for (uint32_t left = header.state_size; ok && left > 0;) {
+				uint32_t n = left < sizeof(skipped) ? left : sizeof(skipped);
+				ok = read_full(conn, skipped, n);
+				left -= n;
+			}
+		}
+		if (!ok) {
+			log_error("Handoff: the running instance went away mid transfer.");
+			if (fd >= 0)
+				close(fd);
+			state->aerospace_fd = -1;
+			close(conn);
+			return false;
+		}
+	}
+	if (same_layout)
+		state->device_count = (int)header.device_count;
+	else
+		log_warn("Handoff: gesture state from a different build, starting it fresh.");
+	return true;
+}
+
+void handoff_confirm(int conn)
+{
+	if (!write_full(conn, "done\n", 5))
+		log_warn("Handoff: the old instance is gone already.");
+	close(conn);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "devices.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Hot restart. A new instance connects to the running one's handoff socket
+ * and receives its aerospace connection, as an fd passed with SCM_RIGHTS,
+ * together with the gesture state of every device. The old instance stops
+ * running commands as it hands over and exits once the new one confirms it
+ * handles gestures; if the new one goes away before that, the old one
+ * carries on as if nothing happened.
+ *
+ * One exchange per connection:
+ *   new -> old  "take\n"
+ *   old -> new  a header, then header.device_count device_states; the fd
+ *               rides in the control data of the first bytes
+ *   new -> old  "done\n"
+ * Gesture state is only taken from a build whose recognizer, device_state
+ * and touch_frame fields all sit at the same offsets with the same sizes,
+ * going by a fingerprint in the header; otherwise the new instance keeps
+ * just the connection and starts its gestures afresh. */
+
+typedef struct {
+	int aerospace_fd; /* -1 for none */
+	int device_count;
+	device_state devices[MAX_DEVICES];
+} handoff_state;
+
+/* The running instance's side, called on the handoff thread. */
+typedef struct {
+	/* Stop running commands and fill in what is handed over; false refuses. */
+	bool (*release)(handoff_state* state);
+	/* The new instance did not confirm; pick up where release left off. */
+	void (*resume)(void);
+	/* The new instance runs, this one should go. */
+	void (*finish)(void);
+} handoff_hooks;
+
+/* /tmp/aerospace-swipe-$USER.handoff.sock; the caller frees it. */
+char* handoff_socket_path(void);
+
+/* Hand over to the first instance that asks on path. */
+bool handoff_serve(const char* path, const handoff_hooks* hooks);
+
+/* Connect to the instance serving path without asking for anything yet, so
+ * a new instance can find out early whether there is one; -1 when none. */
+int handoff_connect(const char* path);
+
+/* Ask for the handover on a connection from handoff_connect. On success
+ * state's fd belongs to the caller, who confirms with handoff_confirm once
+ * it handles gestures. On failure conn is closed and the old instance keeps
+ * running. */
+bool handoff_take(int conn, handoff_state* state);
+
+/* Let the old instance go; closes conn. */
+void handoff_confirm(int conn);
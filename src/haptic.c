@@ -30,35 +30,36 @@ CFTypeRef haptic_open(UInt64 deviceID)
 	return actuator;
 }
 
-CFTypeRef haptic_open_default(void)
+/* Walks the AppleMultitouchDevice services until want is found, or takes
+ * the first one when want is 0. */
+static bool find_device(UInt64 want, UInt64* found)
 {
 	CFMutableDictionaryRef matchDict = IOServiceMatching("AppleMultitouchDevice");
 	if (!matchDict) {
 		fprintf(stderr, "Failed to create match dictionary\n");
-		return NULL;
+		return false;
 	}
 
 	io_iterator_t iter;
 	kern_return_t kr = IOServiceGetMatchingServices(kIOMainPortDefault, matchDict, &iter);
 	if (kr != KERN_SUCCESS) {
 		fprintf(stderr, "Failed to get matching services: 0x%x\n", kr);
-		return NULL;
+		return false;
 	}
 
 	io_object_t device;
-	CFTypeRef actuator = NULL;
+	bool matched = false;
 
-	while ((device = IOIteratorNext(iter))) {
+	while (!matched && (device = IOIteratorNext(iter))) {
 		CFTypeRef idRef = IORegistryEntryCreateCFProperty(
 			device, CFSTR("Multitouch ID"), kCFAllocatorDefault, 0);
 		if (idRef && CFGetTypeID(idRef) == CFNumberGetTypeID()) {
 			UInt64 deviceID;
 			CFNumberGetValue((CFNumberRef)idRef, kCFNumberSInt64Type, &deviceID);
-			CFRelease(idRef);
-			IOObjectRelease(device);
-
-			actuator = haptic_open(deviceID);
-			break;
+			if (want == 0 || deviceID == want) {
+				*found = deviceID;
+				matched = true;
+			}
 		}
 		if (idRef)
 			CFRelease(idRef);
@@ -66,7 +67,23 @@ CFTypeRef haptic_open_default(void)
 	}
 
 	IOObjectRelease(iter);
-	return actuator;
+	return matched;
+}
+
+CFTypeRef haptic_open_default(UInt64* deviceID)
+{
+	UInt64 found;
+	if (!find_device(0, &found))
+		return NULL;
+	if (deviceID)
+		*deviceID = found;
+	return haptic_open(found);
+}
+
+bool haptic_device_exists(UInt64 deviceID)
+{
+	UInt64 found;
+	return deviceID != 0 && find_device(deviceID, &found);
 }
 
 IOReturn haptic_actuate(CFTypeRef actuatorRef, SInt32 actuationID)
@@ -85,3 +102,19 @@ void haptic_close(CFTypeRef actuatorRef)
 	}
 	release(&actuatorRef);
 }
+
+static int mt_actuate(void* device, int32_t actuation)
+{
+	return haptic_actuate((CFTypeRef)device, actuation) == kIOReturnSuccess ? 0 : -1;
+}
+
+static void mt_close(void* device)
+{
+	haptic_close((CFTypeRef)device);
+}
+
+haptic_backend haptic_mt_backend(CFTypeRef actuatorRef)
+{
+	haptic_backend backend = { (void*)actuatorRef, mt_actuate, mt_close };
+	return backend;
+}
@@ -1,5 +1,7 @@
+#ifndef HAPTIC_H
 #define HAPTIC_H
 
+#include "haptic_queue.h"
 #include <CoreFoundation/CoreFoundation.h>
 #include <IOKit/IOReturn.h>
 #include <stdbool.h>
@@ -14,8 +16,19 @@ extern bool MTActuatorIsOpen(CFTypeRef actuatorRef);
 
 CFTypeRef haptic_open(UInt64 deviceID);
 
-CFTypeRef haptic_open_default(void);
+/* The first multitouch device's actuator; deviceID, if not NULL, receives
+ * its id. */
+CFTypeRef haptic_open_default(UInt64* deviceID);
+
+/* Whether a multitouch device with this id is attached, i.e. whether
+ * haptic_open can be tried with it. */
+bool haptic_device_exists(UInt64 deviceID);
 
 IOReturn haptic_actuate(CFTypeRef actuatorRef, SInt32 actuationID);
 
 void haptic_close(CFTypeRef actuatorRef);
+
+/* Wrap an open actuator for haptic_queue; the queue closes it on stop. */
+haptic_backend haptic_mt_backend(CFTypeRef actuatorRef);
+
+#endif
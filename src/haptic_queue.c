@@ -0,0 +1,220 @@
+#include "haptic_queue.h"
+#include "stats.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* must be a power of two; feedback older than a handful of gestures is
+ * pointless, so a full queue drops instead of growing */
+#define HAPTIC_QUEUE_SIZE 16
+
+typedef struct {
+	_Atomic size_t sequence;
+	int32_t actuation;
+	uint64_t posted_ns;
+} haptic_cell;
+
+/* Bounded multi-producer queue (Vyukov style): each cell's sequence number
+ * says whether it is free for the producer at that position or ready for the
+ * consumer, so neither side takes a lock. */
+struct haptic_queue {
+	haptic_cell cells[HAPTIC_QUEUE_SIZE];
+	_Atomic size_t enqueue_pos;
+	_Atomic size_t dequeue_pos;
+
+	_Atomic bool waiting;
+	_Atomic bool running;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_t thread;
+
+	haptic_backend backend;
+	_Atomic uint64_t posted;
+	_Atomic uint64_t dropped;
+	_Atomic uint64_t fired;
+	_Atomic uint64_t failed;
+};
+
+static int null_actuate(void* device, int32_t actuation)
+{
+	(void)device;
+	(void)actuation;
+	return 0;
+}
+
+static void null_close(void* device)
+{
+	(void)device;
+}
+
+haptic_backend haptic_null_backend(void)
+{
+	haptic_backend backend = { NULL, null_actuate, null_close };
+	return backend;
+}
+
+static bool pop(haptic_queue* queue, int32_t* actuation, uint64_t* posted_ns)
+{
+	size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+	for (;;) {
+		haptic_cell* cell = &queue->cells[pos & (HAPTIC_QUEUE_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed)) {
+				*actuation = cell->actuation;
+				*posted_ns = cell->posted_ns;
+				atomic_store_explicit(&cell->sequence, pos + HAPTIC_QUEUE_SIZE, memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+		}
+	}
+}
+
+static void fire(haptic_queue* queue, int32_t actuation, uint64_t posted_ns)
+{
+	uint64_t span = trace_begin();
+	int err = queue->backend.actuate(queue->backend.device, actuation);
+	trace_end("haptic_actuate", span);
+	if (err == 0) {
+		atomic_fetch_add_explicit(&queue->fired, 1, memory_order_relaxed);
+		stats_record(STAGE_HAPTIC, stats_now_ns() - posted_ns);
+	} else {
+		atomic_fetch_add_explicit(&queue->failed, 1, memory_order_relaxed);
+		stats_count(COUNTER_ERRORS);
+	}
+}
+
+static void* drain_thread(void* arg)
+{
+	haptic_queue* queue = arg;
+	int32_t actuation;
+	uint64_t posted_ns;
+
+	for (;;) {
+		while (pop(queue, &actuation, &posted_ns))
+			fire(queue, actuation, posted_ns);
+
+		pthread_mutex_lock(&queue->lock);
+		if (!atomic_load(&queue->running)) {
+			pthread_mutex_unlock(&queue->lock);
+			break;
+		}
+		/* announce the sleep before the final emptiness check; a producer
+		 * either sees the flag and signals, or we see its item */
+		atomic_store(&queue->waiting, true);
+		size_t pos = atomic_load(&queue->dequeue_pos);
+		size_t sequence = atomic_load(&queue->cells[pos & (HAPTIC_QUEUE_SIZE - 1)].sequence);
+		if (sequence != pos + 1 && atomic_load(&queue->running))
+			pthread_cond_wait(&queue->wake, &queue->lock);
+		atomic_store(&queue->waiting, false);
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	/* flush whatever was posted before stop */
+	while (pop(queue, &actuation, &posted_ns))
+		fire(queue, actuation, posted_ns);
+	return NULL;
+}
+
+haptic_queue* haptic_queue_start(haptic_backend backend)
+{
+	haptic_queue* queue = calloc(1, sizeof(haptic_queue));
+	if (!queue) {
+		fprintf(stderr, "Failed to allocate haptic queue.\n");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < HAPTIC_QUEUE_SIZE; ++i)
+		atomic_init(&queue->cells[i].sequence, i);
+	atomic_init(&queue->enqueue_pos, 0);
+	atomic_init(&queue->dequeue_pos, 0);
+	atomic_init(&queue->waiting, false);
+	atomic_init(&queue->running, true);
+	queue->backend = backend;
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->wake, NULL);
+
+	if (pthread_create(&queue->thread, NULL, drain_thread, queue) != 0) {
+		fprintf(stderr, "Failed to start haptic thread.\n");
+		pthread_mutex_destroy(&queue->lock);
+		pthread_cond_destroy(&queue->wake);
+		free(queue);
+		return NULL;
+	}
+	return queue;
+}
+
+bool haptic_queue_post(haptic_queue* queue, int32_t actuation)
+{
+	if (!queue)
+		return false;
+
+	size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+	for (;;) {
+		haptic_cell* cell = &queue->cells[pos & (HAPTIC_QUEUE_SIZE - 1)];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+			stats_count(COUNTER_DROPS);
+			return false;
+		} else {
+			pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+		}
+	}
+
+	haptic_cell* cell = &queue->cells[pos & (HAPTIC_QUEUE_SIZE - 1)];
+	cell->actuation = actuation;
+	cell->posted_ns = stats_now_ns();
+	atomic_store(&cell->sequence, pos + 1);
+	atomic_fetch_add_explicit(&queue->posted, 1, memory_order_relaxed);
+
+	/* only touch the mutex when the drain thread is actually asleep */
+	if (atomic_load(&queue->waiting)) {
+		pthread_mutex_lock(&queue->lock);
+		pthread_cond_signal(&queue->wake);
+		pthread_mutex_unlock(&queue->lock);
+	}
+	return true;
+}
+
+haptic_queue_stats haptic_queue_get_stats(haptic_queue* queue)
+{
+	haptic_queue_stats stats = { 0, 0, 0, 0 };
+	if (!queue)
+		return stats;
+	stats.posted = atomic_load_explicit(&queue->posted, memory_order_relaxed);
+	stats.dropped = atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+	stats.fired = atomic_load_explicit(&queue->fired, memory_order_relaxed);
+	stats.failed = atomic_load_explicit(&queue->failed, memory_order_relaxed);
+	return stats;
+}
+
+void haptic_queue_stop(haptic_queue* queue)
+{
+	if (!queue)
+		return;
+
+	pthread_mutex_lock(&queue->lock);
+	atomic_store(&queue->running, false);
+	pthread_cond_signal(&queue->wake);
+	pthread_mutex_unlock(&queue->lock);
+	pthread_join(queue->thread, NULL);
+
+	queue->backend.close(queue->backend.device);
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->wake);
+	free(queue);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A haptic device behind a small vtable, so the queue can run against the
+ * MultitouchSupport actuator on macOS or the null backend elsewhere. */
+typedef struct {
+	void* device;
+	/* returns 0 on success */
+	int (*actuate)(void* device, int32_t actuation);
+	void (*close)(void* device);
+} haptic_backend;
+
+typedef enum {
+	HAPTIC_ON_RECOGNITION, /* as soon as a gesture is recognized */
+	HAPTIC_ON_SWITCH /* once aerospace confirms the command */
+} haptic_policy;
+
+typedef struct {
+	uint64_t posted;
+	uint64_t dropped;
+	uint64_t fired;
+	uint64_t failed;
+} haptic_queue_stats;
+
+typedef struct haptic_queue haptic_queue;
+
+/* Backend that accepts and counts actuations without touching hardware. */
+haptic_backend haptic_null_backend(void);
+
+/* Start the drain thread. The queue owns the backend from here on. */
+haptic_queue* haptic_queue_start(haptic_backend backend);
+
+/* Lock-free and safe from any thread; returns false (and counts a drop) when
+ * the queue is full rather than blocking the caller. */
+bool haptic_queue_post(haptic_queue* queue, int32_t actuation);
+
+haptic_queue_stats haptic_queue_get_stats(haptic_queue* queue);
+
+/* Drain pending actuations, stop the thread and close the backend. */
+void haptic_queue_stop(haptic_queue* queue);
@@ -0,0 +1,138 @@
+#include "input.h"
+#include "stats.h"
+#include "touch_trace.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Streams and traces share the touch_trace reader and differ in timing:
+ * a stream is stamped on arrival, a trace is paced by its own timestamps. */
+typedef struct {
+	uint64_t device;
+	trace_reader reader;
+	FILE* file; /* owned by traces, NULL for streams */
+	double speed;
+	bool started;
+	double first_t; /* trace time of the first frame */
+	uint64_t first_ns; /* when the first frame was played */
+} trace_source;
+
+/* high enough not to collide with the device numbers evdev sources use */
+static _Atomic uint64_t next_device = 1ull << 32;
+
+uint64_t input_next_device_id(void)
+{
+	return atomic_fetch_add_explicit(&next_device, 1, memory_order_relaxed);
+}
+
+static void copy_frame(const trace_source* source, const trace_frame* in, input_frame* out, double timestamp)
+{
+	out->device = source->device;
+	out->count = in->count;
+	for (int i = 0; i < in->count; ++i) {
+		out->touches[i] = in->touches[i];
+		out->touches[i].timestamp = timestamp;
+	}
+}
+
+static bool next_stream(void* source, input_frame* frame)
+{
+	trace_source* stream = source;
+	trace_frame in;
+	while (touch_trace_next(&stream->reader, &in)) {
+		if (in.count == 0)
+			continue;
+		copy_frame(stream, &in, frame, stats_now_ns() / 1e9);
+		return true;
+	}
+	return false;
+}
+
+static void sleep_until(uint64_t due_ns)
+{
+	for (;;) {
+		uint64_t now = stats_now_ns();
+		if (now >= due_ns)
+			return;
+		uint64_t left = due_ns - now;
+		struct timespec ts = { (time_t)(left / 1000000000ull), (long)(left % 1000000000ull) };
+		nanosleep(&ts, NULL);
+	}
+}
+
+static bool next_trace(void* source, input_frame* frame)
+{
+	trace_source* trace = source;
+	trace_frame in;
+	while (touch_trace_next(&trace->reader, &in)) {
+		if (in.count == 0)
+			continue;
+		double t = in.touches[0].timestamp;
+		if (!trace->started) {
+			trace->started = true;
+			trace->first_t = t;
+			trace->first_ns = stats_now_ns();
+		}
+
+		/* as fast as possible keeps the recorded spacing in the stamps, so
+		 * velocities and the cooldown come out the same */
+		double offset = t - trace->first_t;
+		if (trace->speed > 0.0) {
+			offset /= trace->speed;
+			sleep_until(trace->first_ns + (uint64_t)(offset > 0.0 ? offset * 1e9 : 0.0));
+		}
+		copy_frame(trace, &in, frame, trace->first_ns / 1e9 + offset);
+		return true;
+	}
+	return false;
+}
+
+static void close_trace(void* source)
+{
+	trace_source* trace = source;
+	if (trace->file)
+		fclose(trace->file);
+	free(trace);
+}
+
+bool input_open_stream(FILE* file, const char* name, input_backend* out)
+{
+	trace_source* stream = calloc(1, sizeof(trace_source));
+	if (!stream) {
+		fprintf(stderr, "Error: out of memory opening %s\n", name);
+		return false;
+	}
+	stream->device = input_next_device_id();
+	touch_trace_reader_init(&stream->reader, file, name);
+	out->source = stream;
+	out->name = name;
+	out->next = next_stream;
+	out->close = close_trace;
+	return true;
+}
+
+bool input_open_trace(const char* path, double speed, input_backend* out)
+{
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Error: cannot open %s\n", path);
+		return false;
+	}
+	trace_source* trace = calloc(1, sizeof(trace_source));
+	if (!trace) {
+		fprintf(stderr, "Error: out of memory opening %s\n", path);
+		fclose(file);
+		return false;
+	}
+	trace->device = input_next_device_id();
+	touch_trace_reader_init(&trace->reader, file, path);
+	trace->file = file;
+	trace->speed = speed;
+	out->source = trace;
+	out->name = path;
+	out->next = next_trace;
+	out->close = close_trace;
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "touch.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* A source of contact frames behind a small vtable, so the recognizer
+ * pipeline can be driven by a Linux multitouch device, a pipe or a recorded
+ * trace as well as by the event tap on macOS.
+ *
+ * Backends report positions, phases and ids only; velocities are left to the
+ * contact table like they are for NSTouch. Timestamps are on the stats_now_ns
+ * clock, in seconds, so input to command latency can be measured against it. */
+
+#define INPUT_MAX_CONTACTS 16
+
+typedef struct {
+	uint64_t device; /* stable per source, never 0 */
+	int count; /* never 0; frames without contacts are not reported */
+	touch touches[INPUT_MAX_CONTACTS];
+} input_frame;
+
+typedef struct {
+	void* source;
+	const char* name;
+	/* blocks for the next frame; false at the end of input or on an error,
+	 * which the backend has reported */
+	bool (*next)(void* source, input_frame* frame);
+	void (*close)(void* source);
+} input_backend;
+
+/* A device id for a source that has none of its own. */
+uint64_t input_next_device_id(void);
+
+/* Frames in the touch_trace text format as they arrive on file, typically
+ * stdin or a pipe, stamped with their arrival time. Gesture lines are
+ * ignored. The file is not closed. */
+bool input_open_stream(FILE* file, const char* name, input_backend* out);
+
+/* A recorded trace played back at its own pace times speed (0 for as fast
+ * as possible), restamped as if it was happening now. */
+bool input_open_trace(const char* path, double speed, input_backend* out);
+
+/* A multitouch device speaking evdev MT protocol B, e.g. /dev/input/event5.
+ * Linux only; elsewhere it reports that and returns false. */
+bool input_open_evdev(const char* path, input_backend* out);
+
+static inline void input_close(input_backend* backend)
+{
+	if (backend->close)
+		backend->close(backend->source);
+	backend->source = NULL;
+}
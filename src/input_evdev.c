@@ -0,0 +1,265 @@
+#include "input.h"
+#include <stdio.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* MT protocol B: the kernel keeps one slot per contact and only sends what
+ * changed, ABS_MT_SLOT picks the slot the next events apply to and
+ * ABS_MT_TRACKING_ID -1 frees it. SYN_REPORT closes a frame. */
+
+#define EVDEV_SLOTS INPUT_MAX_CONTACTS
+
+typedef struct {
+	int tracking_id; /* -1 when free */
+	int x, y;
+	uint64_t id; /* ours, unique for the life of the source */
+	bool began; /* landed in this frame */
+	bool moved;
+	bool ended; /* lifted in this frame, reported once more */
+} evdev_slot;
+
+typedef struct {
+	int fd;
+	const char* name;
+	uint64_t device;
+	int slot_count;
+	int slot;
+	struct input_absinfo abs_x, abs_y;
+	evdev_slot slots[EVDEV_SLOTS];
+	uint64_t next_id;
+	bool dropped; /* the kernel buffer overflowed; skip to the next report */
+	struct input_event events[64];
+	int buffered, next_event;
+} evdev_source;
+
+static void land(evdev_source* dev, evdev_slot* slot, int tracking_id)
+{
+	slot->tracking_id = tracking_id;
+	slot->id = dev->next_id++;
+	slot->began = true;
+	slot->moved = false;
+	slot->ended = false;
+}
+
+static void apply(evdev_source* dev, const struct input_event* ev)
+{
+	if (ev->code == ABS_MT_SLOT) {
+		dev->slot = ev->value;
+		return;
+	}
+	if (dev->slot < 0 || dev->slot >= dev->slot_count)
+		return;
+
+	evdev_slot* slot = &dev->slots[dev->slot];
+	switch (ev->code) {
+	case ABS_MT_TRACKING_ID:
+		if (ev->value < 0) {
+			if (slot->tracking_id >= 0)
+				slot->ended = true;
+			slot->tracking_id = -1;
+		} else if (ev->value != slot->tracking_id) {
+			/* a lift and a landing folded into one frame; the old contact
+			 * simply goes stale in the contact table */
+			land(dev, slot, ev->value);
+		}
+		break;
+	case ABS_MT_POSITION_X:
+		slot->x = ev->value;
+		slot->moved = true;
+		break;
+	case ABS_MT_POSITION_Y:
+		slot->y = ev->value;
+		slot->moved = true;
+		break;
+	}
+}
+
+/* Re-read every slot after SYN_DROPPED, since the deltas in between are gone. */
+static void resync(evdev_source* dev)
+{
+	struct {
+		__u32 code;
+		__s32 values[EVDEV_SLOTS];
+	} request;
+
+	request.code = ABS_MT_TRACKING_ID;
+	if (ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(request)), &request) < 0)
+		return;
+	for (int i = 0; i < dev->slot_count; ++i) {
+		evdev_slot* slot = &dev->slots[i];
+		int tracking_id = request.values[i];
+		if (tracking_id < 0 && slot->tracking_id >= 0)
+			slot->ended = true;
+		if (tracking_id < 0)
+			slot->tracking_id = -1;
+		else if (tracking_id != slot->tracking_id)
+			land(dev, slot, tracking_id);
+	}
+
+	request.code = ABS_MT_POSITION_X;
+	if (ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(request)), &request) == 0)
+		for (int i = 0; i < dev->slot_count; ++i)
+			dev->slots[i].x = request.values[i];
+	request.code = ABS_MT_POSITION_Y;
+	if (ioctl(dev->fd, EVIOCGMTSLOTS(sizeof(request)), &request) == 0)
+		for (int i = 0; i < dev->slot_count; ++i)
+			dev->slots[i].y = request.values[i];
+
+	struct input_absinfo slot;
+	if (ioctl(dev->fd, EVIOCGABS(ABS_MT_SLOT), &slot) == 0)
+		dev->slot = slot.value;
+}
+
+static double normalize(int value, const struct input_absinfo* range)
+{
+	return (double)(value - range->minimum) / (range->maximum - range->minimum);
+}
+
+/* The contacts of the frame SYN_REPORT just closed; false when there are
+ * none to report. */
+static bool report(evdev_source* dev, double timestamp, input_frame* frame)
+{
+	int count = 0;
+	frame->device = dev->device;
+	for (int i = 0; i < dev->slot_count; ++i) {
+		evdev_slot* slot = &dev->slots[i];
+		if (slot->tracking_id < 0 && !slot->ended)
+			continue;
+
+		touch* out = &frame->touches[count++];
+		memset(out, 0, sizeof(*out));
+		out->id = slot->id;
+		out->x = normalize(slot->x, &dev->abs_x);
+		/* evdev y grows downwards, NSTouch upwards */
+		out->y = 1.0 - normalize(slot->y, &dev->abs_y);
+		out->timestamp = timestamp;
+		/* NSTouchPhase: began 1, moved 2, stationary 4, ended 8 */
+		out->phase = slot->ended ? TOUCH_PHASE_ENDED : slot->began ? 1 : slot->moved ? 2 : 4;
+
+		slot->began = false;
+		slot->moved = false;
+		slot->ended = false;
+	}
+	frame->count = count;
+	return count > 0;
+}
+
+static bool next_evdev(void* source, input_frame* frame)
+{
+	evdev_source* dev = source;
+	for (;;) {
+		if (dev->next_event == dev->buffered) {
+			ssize_t n = read(dev->fd, dev->events, sizeof(dev->events));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				fprintf(stderr, "Error: reading %s: %s\n", dev->name, strerror(errno));
+			if (n <= 0)
+				return false;
+			dev->buffered = (int)(n / sizeof(struct input_event));
+			dev->next_event = 0;
+		}
+
+		const struct input_event* ev = &dev->events[dev->next_event++];
+		if (ev->type == EV_SYN && ev->code == SYN_DROPPED) {
+			dev->dropped = true;
+			continue;
+		}
+		bool end_of_frame = ev->type == EV_SYN && ev->code == SYN_REPORT;
+		if (dev->dropped) {
+			if (!end_of_frame)
+				continue;
+			dev->dropped = false;
+			resync(dev);
+		} else if (ev->type == EV_ABS) {
+			apply(dev, ev);
+		}
+
+		if (end_of_frame) {
+#ifdef input_event_sec
+			double timestamp = ev->input_event_sec + ev->input_event_usec / 1e6;
+#else
+			double timestamp = ev->time.tv_sec + ev->time.tv_usec / 1e6;
+#endif
+			if (report(dev, timestamp, frame))
+				return true;
+		}
+	}
+}
+
+static void close_evdev(void* source)
+{
+	evdev_source* dev = source;
+	close(dev->fd);
+	free(dev);
+}
+
+bool input_open_evdev(const char* path, input_backend* out)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	evdev_source* dev = calloc(1, sizeof(evdev_source));
+	if (!dev) {
+		fprintf(stderr, "Error: out of memory opening %s\n", path);
+		close(fd);
+		return false;
+	}
+	dev->fd = fd;
+	dev->name = path;
+	dev->next_id = 1;
+	/* the device number survives reopening, unlike the fd */
+	struct stat info;
+	dev->device = fstat(fd, &info) == 0 && info.st_rdev ? (uint64_t)info.st_rdev : input_next_device_id();
+
+	struct input_absinfo slot;
+	if (ioctl(fd, EVIOCGABS(ABS_MT_SLOT), &slot) < 0 || ioctl(fd, EVIOCGABS(ABS_MT_POSITION_X), &dev->abs_x) < 0
+		|| ioctl(fd, EVIOCGABS(ABS_MT_POSITION_Y), &dev->abs_y) < 0
+		|| dev->abs_x.maximum <= dev->abs_x.minimum || dev->abs_y.maximum <= dev->abs_y.minimum) {
+		fprintf(stderr, "Error: %s is not a multitouch (MT protocol B) device\n", path);
+		close_evdev(dev);
+		return false;
+	}
+	dev->slot_count = slot.maximum + 1 < EVDEV_SLOTS ? slot.maximum + 1 : EVDEV_SLOTS;
+	dev->slot = slot.value;
+	for (int i = 0; i < EVDEV_SLOTS; ++i)
+		dev->slots[i].tracking_id = -1;
+
+	/* stamp events on the clock stats_now_ns reads */
+	int clock = CLOCK_MONOTONIC;
+	if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0)
+		fprintf(stderr, "Warning: %s keeps realtime event stamps; latencies will be off\n", path);
+
+	/* contacts already down when we start */
+	resync(dev);
+
+	out->source = dev;
+	out->name = path;
+	out->next = next_evdev;
+	out->close = close_evdev;
+	return true;
+}
+
+#else
+
+bool input_open_evdev(const char* path, input_backend* out)
+{
+	(void)out;
+	fprintf(stderr, "Error: %s: evdev input is only available on Linux\n", path);
+	return false;
+}
+
+#endif
@@ -0,0 +1,301 @@
+#include "log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_BYTES 240
+/* must be a power of two */
+#define RING_LINES 64
+#define FLUSH_INTERVAL_NS 100000000L
+#define RATE_WINDOW_NS 1000000000ull
+
+typedef struct {
+	uint64_t time_ns; /* wall clock, for the timestamp prefix */
+	uint8_t level;
+	uint16_t len;
+	char text[LINE_BYTES];
+} log_line;
+
+/* Single producer (the owning thread), single consumer (whoever holds
+ * drain_mutex). Rings are never freed: when a thread exits its ring is
+ * released and the next new thread adopts it, so a churning GCD pool does not
+ * grow the list. */
+typedef struct log_ring {
+	struct log_ring* next;
+	_Atomic bool in_use;
+	_Atomic uint32_t head;
+	_Atomic uint32_t tail;
+	_Atomic uint64_t dropped;
+	uint64_t reported_dropped;
+	log_line lines[RING_LINES];
+} log_ring;
+
+_Atomic int log_threshold = LOG_LEVEL_WARN;
+static _Atomic bool pinned = false;
+static _Atomic(log_ring*) rings = NULL;
+static _Thread_local log_ring* local_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* const level_names[] = { "error", "warn", "info", "debug" };
+
+static void release_ring(void* ring)
+{
+	atomic_store_explicit(&((log_ring*)ring)->in_use, false, memory_order_release);
+}
+
+static void make_key(void)
+{
+	pthread_key_create(&ring_key, release_ring);
+}
+
+static log_ring* acquire_ring(void)
+{
+	for (log_ring* ring = atomic_load_explicit(&rings, memory_order_acquire); ring; ring = ring->next) {
+		bool expected = false;
+		if (atomic_compare_exchange_strong_explicit(&ring->in_use, &expected, true,
+				memory_order_acquire, memory_order_relaxed))
+			return ring;
+	}
+
+	log_ring* ring = calloc(1, sizeof(log_ring));
+	if (!ring)
+		return NULL;
+	atomic_init(&ring->in_use, true);
+	ring->next = atomic_load_explicit(&rings, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(&rings, &ring->next, ring, memory_order_release,
+		memory_order_relaxed))
+		;
+	return ring;
+}
+
+static uint64_t wall_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Token window per call site. Races between threads only blur the count by a
+ * line or two, which is fine for a rate limit. */
+static bool admit(log_site* site, uint64_t now, uint32_t* suppressed)
+{
+	uint64_t window = atomic_load_explicit(&site->window_ns, memory_order_relaxed);
+	if (now - window >= RATE_WINDOW_NS
+		&& atomic_compare_exchange_strong_explicit(&site->window_ns, &window, now,
+			memory_order_relaxed, memory_order_relaxed)) {
+		atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+		*suppressed = atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+	}
+
+	if (atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed) < LOG_BURST)
+		return true;
+	atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+	return false;
+}
+
+void log_write(log_site* site, log_level level, const char* fmt, ...)
+{
+	uint64_t now = wall_ns();
+	uint32_t suppressed = 0;
+	if (!admit(site, now, &suppressed))
+		return;
+
+	if (!local_ring) {
+		pthread_once(&key_once, make_key);
+		local_ring = acquire_ring();
+		if (!local_ring)
+			return;
+		pthread_setspecific(ring_key, local_ring);
+	}
+
+	log_ring* ring = local_ring;
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == RING_LINES) {
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	log_line* line = &ring->lines[head & (RING_LINES - 1)];
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(line->text, LINE_BYTES, fmt, args);
+	va_end(args);
+	if (len < 0)
+		len = 0;
+	if (len >= LINE_BYTES)
+		len = LINE_BYTES - 1;
+	while (len > 0 && line->text[len - 1] == '\n')
+		--len;
+	if (suppressed) {
+		int extra = snprintf(line->text + len, LINE_BYTES - len, " (%u more suppressed)", suppressed);
+		if (extra > 0)
+			len = len + extra < LINE_BYTES ? len + extra : LINE_BYTES - 1;
+	}
+
+	line->len = (uint16_t)len;
+	line->level = (uint8_t)level;
+	line->time_ns = now;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void write_all(int fd, const char* data, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		data += n;
+		len -= n;
+	}
+}
+
+typedef struct {
+	int fd;
+	size_t used;
+	char data[8192];
+} out_buffer;
+
+static void out_append(out_buffer* out, const char* text, size_t len)
+{
+	if (out->used + len > sizeof(out->data)) {
+		write_all(out->fd, out->data, out->used);
+		out->used = 0;
+	}
+	memcpy(out->data + out->used, text, len);
+	out->used += len;
+}
+
+static void out_line(out_buffer* out, uint64_t time_ns, log_level level, const char* text, size_t len)
+{
+	time_t seconds = (time_t)(time_ns / 1000000000ull);
+	struct tm local;
+	localtime_r(&seconds, &local);
+
+	char prefix[48];
+	int n = snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d [%s] ", local.tm_hour,
+		local.tm_min, local.tm_sec, (int)(time_ns / 1000000 % 1000), level_names[level]);
+	out_append(out, prefix, n);
+	out_append(out, text, len);
+	out_append(out, "\n", 1);
+}
+
+/* Merge every ring into time order; errors and warnings go to stderr and the
+ * rest to stdout, as the printf calls this replaced did. */
+static void drain(void)
+{
+	static out_buffer err = { .fd = STDERR_FILENO };
+	static out_buffer out = { .fd = STDOUT_FILENO };
+
+	pthread_mutex_lock(&drain_mutex);
+	for (;;) {
+		log_ring* oldest = NULL;
+		uint64_t oldest_ns = 0;
+		for (log_ring* ring = atomic_load_explicit(&rings, memory_order_acquire); ring; ring = ring->next) {
+			uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+			if (tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+				continue;
+			uint64_t time_ns = ring->lines[tail & (RING_LINES - 1)].time_ns;
+			if (!oldest || time_ns < oldest_ns) {
+				oldest = ring;
+				oldest_ns = time_ns;
+			}
+		}
+		if (!oldest)
+			break;
+
+		uint32_t tail = atomic_load_explicit(&oldest->tail, memory_order_relaxed);
+		log_line* line = &oldest->lines[tail & (RING_LINES - 1)];
+		out_line(line->level <= LOG_LEVEL_WARN ? &err : &out, line->time_ns, line->level, line->text,
+			line->len);
+		atomic_store_explicit(&oldest->tail, tail + 1, memory_order_release);
+	}
+
+	for (log_ring* ring = atomic_load_explicit(&rings, memory_order_acquire); ring; ring = ring->next) {
+		uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+		if (dropped != ring->reported_dropped) {
+			char text[64];
+			int n = snprintf(text, sizeof(text), "log ring full, dropped %llu lines",
+				(unsigned long long)(dropped - ring->reported_dropped));
+			out_line(&err, wall_ns(), LOG_LEVEL_WARN, text, n);
+			ring->reported_dropped = dropped;
+		}
+	}
+
+	write_all(err.fd, err.data, err.used);
+	err.used = 0;
+	write_all(out.fd, out.data, out.used);
+	out.used = 0;
+	pthread_mutex_unlock(&drain_mutex);
+}
+
+void log_flush(void)
+{
+	drain();
+}
+
+static void* writer_thread(void* arg)
+{
+	(void)arg;
+	for (;;) {
+		struct timespec ts = { 0, FLUSH_INTERVAL_NS };
+		nanosleep(&ts, NULL);
+		drain();
+	}
+	return NULL;
+}
+
+bool log_parse_level(const char* name, log_level* out)
+{
+	for (int i = 0; i < (int)(sizeof(level_names) / sizeof(level_names[0])); ++i) {
+		if (strcasecmp(name, level_names[i]) == 0) {
+			*out = (log_level)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* log_level_name(log_level level)
+{
+	return level_names[level];
+}
+
+void log_set_level(log_level level)
+{
+	if (!atomic_load_explicit(&pinned, memory_order_relaxed))
+		atomic_store_explicit(&log_threshold, level, memory_order_relaxed);
+}
+
+bool log_start(void)
+{
+	pthread_once(&key_once, make_key);
+
+	const char* env = getenv("AEROSPACE_SWIPE_LOG");
+	log_level level;
+	if (env && log_parse_level(env, &level)) {
+		atomic_store(&log_threshold, level);
+		atomic_store(&pinned, true);
+	} else if (env) {
+		fprintf(stderr, "Log: unknown level '%s', expected error, warn, info or debug.\n", env);
+	}
+
+	atexit(log_flush);
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, writer_thread, NULL) != 0) {
+		fprintf(stderr, "Log: failed to start writer thread.\n");
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Logging for the gesture path. A message is formatted into a ring owned by
+ * the calling thread and written out by a background thread, so logging never
+ * blocks or makes a syscall on the caller. Messages below the current level
+ * cost one relaxed load; each call site is limited to LOG_BURST lines per
+ * second. */
+
+typedef enum {
+	LOG_LEVEL_ERROR,
+	LOG_LEVEL_WARN,
+	LOG_LEVEL_INFO,
+	LOG_LEVEL_DEBUG
+} log_level;
+
+#define LOG_BURST 20
+
+/* per call site rate limit state, created by the log_* macros */
+typedef struct {
+	_Atomic uint64_t window_ns;
+	_Atomic uint32_t count;
+	_Atomic uint32_t suppressed;
+} log_site;
+
+extern _Atomic int log_threshold;
+
+static inline bool log_enabled(log_level level)
+{
+	return (int)level <= atomic_load_explicit(&log_threshold, memory_order_relaxed);
+}
+
+void log_write(log_site* site, log_level level, const char* fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+#define log_at(level, ...)                              \
+	do {                                                \
+		if (log_enabled(level)) {                       \
+			static log_site log_site_;                  \
+			log_write(&log_site_, level, __VA_ARGS__); \
+		}                                               \
+	} while (0)
+
+#define log_error(...) log_at(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define log_warn(...) log_at(LOG_LEVEL_WARN, __VA_ARGS__)
+#define log_info(...) log_at(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_debug(...) log_at(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/* Start the writer thread. AEROSPACE_SWIPE_LOG=error|warn|info|debug pins the
+ * level, overriding the config. */
+bool log_start(void);
+
+/* Level from the config; ignored while the environment pins it. */
+void log_set_level(log_level level);
+
+bool log_parse_level(const char* name, log_level* out);
+const char* log_level_name(log_level level);
+
+/* Write everything buffered so far, from the calling thread. For exit paths. */
+void log_flush(void);
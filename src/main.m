@@ -2,133 +2,235 @@
 #include "Cocoa/Cocoa.h"
 #include "aerospace.h"
 #include "config.h"
+#include "config_watch.h"
+#include "control.h"
+#include "devices.h"
+#include "executor.h"
 #import "event_tap.h"
+#include "flight_recorder.h"
+#include "handoff.h"
 #include "haptic.h"
+#include "log.h"
+#include "recognizer.h"
+#include "stats.h"
+#include "touch_trace.h"
+#include "trace.h"
 #include <AppKit/AppKit.h>
 #import <ApplicationServices/ApplicationServices.h>
+#include <mach/mach_time.h>
 #include <pthread.h>
+#include <stdatomic.h>
+
+/* NULL until the background connect gets through */
+static _Atomic(Aerospace*) client = NULL;
+/* the default trackpad's actuator, shared by devices without their own */
+static haptic_queue* haptics = NULL;
+static UInt64 haptics_device = 0;
+static pthread_mutex_t recordingMutex = PTHREAD_MUTEX_INITIALIZER;
+/* guarded by recordingMutex */
+static FILE* recording;
+static double recorded_until;
+/* set while taking over from a running instance, which handles the
+ * gestures until then */
+static atomic_bool standby;
+
+/* Each trackpad's frames are fed in order on a serial queue of its own.
+ * pending counts the frames queued and not yet fed; only when it is zero
+ * does the prefilter judge a frame, so it changes the recognizer's state in
+ * the same order feeding would. The table is only touched on the event tap
+ * thread. */
+typedef struct {
+	uint64_t id;
+	dispatch_queue_t queue;
+	atomic_int pending;
+} device_queue;
+static device_queue device_queues[MAX_DEVICES];
+static int device_queue_count;
+
+/* NULL once MAX_DEVICES have one; the frame should then be dropped */
+static device_queue* device_queue_for(uint64_t id)
+{
+	for (int i = 0; i < device_queue_count; ++i)
+		if (device_queues[i].id == id)
+			return &device_queues[i];
+	if (device_queue_count == MAX_DEVICES)
+		return NULL;
+	device_queue* entry = &device_queues[device_queue_count];
+	entry->queue = dispatch_queue_create("com.acsandmann.swipe.device", DISPATCH_QUEUE_SERIAL);
+	if (!entry->queue)
+		return NULL;
+	entry->id = id;
+	atomic_init(&entry->pending, 0);
+	device_queue_count++;
+	return entry;
+}
 
-#define ACTIVE_TOUCH_THRESHOLD 0.05f
-#define SWIPE_THRESHOLD 0.15f
-#define SWIPE_VELOCITY_THRESHOLD 0.75f
-#define SWIPE_COOLDOWN 0.3f
+/* AEROSPACE_SWIPE_RECORD=path appends every frame as an unlabelled trace for
+ * swipe-replay; a pause of a quarter second starts a new gesture */
+static void start_recording(void)
+{
+	const char* path = getenv("AEROSPACE_SWIPE_RECORD");
+	if (!path || !*path)
+		return;
+	recording = fopen(path, "a");
+	if (!recording) {
+		log_error("Cannot open trace recording %s", path);
+		return;
+	}
+	setvbuf(recording, NULL, _IOLBF, 0);
+	log_info("Recording touch frames to %s", path);
+}
 
-static Aerospace* client = NULL;
-static CFTypeRef haptic = NULL;
-static Config config;
-static pthread_mutex_t gestureMutex = PTHREAD_MUTEX_INITIALIZER;
+static void record_frame(const touch_frame* frame)
+{
+	touch contacts[FRAME_CONTACTS];
+	int count = touch_frame_stored(frame);
+	for (int i = 0; i < count; ++i)
+		contacts[i] = touch_frame_get(frame, i);
+
+	pthread_mutex_lock(&recordingMutex);
+	if (frame->timestamp - recorded_until > 0.25)
+		touch_trace_write_label(recording, TRACE_UNLABELLED);
+	recorded_until = frame->timestamp;
+	touch_trace_write_frame(recording, contacts, count);
+	pthread_mutex_unlock(&recordingMutex);
+}
 
-static void switch_workspace(const char* ws)
+/* A trackpad with its own actuator gets its own queue; the rest share the
+ * default trackpad's. */
+static haptic_queue* open_device_haptics(uint64_t device)
 {
-	if (config.skip_empty || config.wrap_around) {
-		char* workspaces = aerospace_list_workspaces(client, config.skip_empty);
-		if (!workspaces) {
-			fprintf(stderr, "Error: Unable to retrieve workspace list.\n");
-			return;
-		}
-		char* result = aerospace_workspace(client, config.wrap_around, ws, workspaces);
-		if (result) {
-			fprintf(stderr, "Error: Failed to switch workspace to '%s'.\n", ws);
-		} else {
-			printf("Switched workspace successfully to '%s'.\n", ws);
-		}
-		free(workspaces);
-	} else {
-		char* result = aerospace_switch(client, ws);
-		if (result) {
-			fprintf(stderr, "Error: Failed to switch workspace: '%s'\n", result);
-		} else {
-			printf("Switched workspace successfully to '%s'.\n", ws);
-		}
+	if (device == haptics_device || !haptic_device_exists(device))
+		return haptics;
+	CFTypeRef actuator = haptic_open(device);
+	haptic_queue* queue = actuator ? haptic_queue_start(haptic_mt_backend(actuator)) : NULL;
+	if (!queue) {
+		if (actuator)
+			haptic_close(actuator);
+		return haptics;
 	}
-
-	if (config.haptic == true)
-		haptic_actuate(haptic, 3);
+	return queue;
 }
 
-static void gestureCallback(touch* contacts, int numContacts)
+/* NSTouch.device is opaque. Where it answers to deviceID, the
+ * MultitouchSupport id its actuator opens by, use that; otherwise its hash
+ * still tells trackpads apart. Main thread only. */
+static uint64_t touch_device_id(NSTouch* touch)
 {
-	pthread_mutex_lock(&gestureMutex);
-	static bool swiping = false;
-	static float startAvgX = 0.0f;
-	static float startAvgY = 0.0f;
-	static double lastSwipeTime = 0.0;
-	static int consecutiveRightFrames = 0;
-	static int consecutiveLeftFrames = 0;
-
-	if (numContacts != config.fingers || (contacts[0].timestamp - lastSwipeTime) < SWIPE_COOLDOWN) {
-		swiping = false;
-		consecutiveRightFrames = 0;
-		consecutiveLeftFrames = 0;
-		pthread_mutex_unlock(&gestureMutex);
-		return;
+	static void* last_device = NULL;
+	static uint64_t last_id = 0;
+	id device = touch.device;
+	if ((__bridge void*)device == last_device)
+		return last_id;
+
+	uint64_t device_id = (uint64_t)[device hash];
+	@try {
+		id value = [device valueForKey:@"deviceID"];
+		if ([value respondsToSelector:@selector(unsignedLongLongValue)])
+			device_id = [value unsignedLongLongValue];
+	} @catch (NSException* exception) {
 	}
+	last_device = (__bridge void*)device;
+	last_id = device_id;
+	return device_id;
+}
+
+/* CGEvent timestamps are mach_absolute_time ticks, which are only
+ * nanoseconds on Intel */
+static uint64_t event_time_ns(CGEventRef event)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return CGEventGetTimestamp(event) * timebase.numer / timebase.denom;
+}
 
-	float sumX = 0.0f;
-	float sumVelX = 0.0f;
-	float sumY = 0.0f;
+static swipe_modifier modifier_from_flags(CGEventFlags flags)
+{
+	if (flags & kCGEventFlagMaskCommand)
+		return MODIFIER_COMMAND;
+	if (flags & kCGEventFlagMaskAlternate)
+		return MODIFIER_OPTION;
+	if (flags & kCGEventFlagMaskControl)
+		return MODIFIER_CONTROL;
+	if (flags & kCGEventFlagMaskShift)
+		return MODIFIER_SHIFT;
+	return MODIFIER_NONE;
+}
 
-	for (int i = 0; i < numContacts; ++i) {
-		sumX += contacts[i].x;
-		sumVelX += contacts[i].velocity;
-		sumY += contacts[i].y;
+/* Hands a binding to the executor, or drops it while aerospace is not
+ * connected yet. */
+static void run_binding(haptic_queue* queue, const Config* config, const Binding* binding, uint64_t event_ns)
+{
+	Aerospace* aerospace = atomic_load_explicit(&client, memory_order_acquire);
+	if (!aerospace) {
+		log_warn("Not connected to aerospace yet, dropping '%s'.", binding->label);
+		stats_count(COUNTER_DROPS);
+		return;
 	}
+	execute_binding(aerospace, queue, config, binding, event_ns);
+}
 
-	const float avgX = sumX / numContacts;
-	const float avgVelX = sumVelX / numContacts;
-	const float avgY = sumY / numContacts;
-
-	if (!swiping) {
-		swiping = true;
-		startAvgX = avgX;
-		startAvgY = avgY;
-		consecutiveRightFrames = 0;
-		consecutiveLeftFrames = 0;
-	} else {
-		const float deltaX = avgX - startAvgX;
-        const float deltaY = avgY - startAvgY;
-
-        if (fabs(deltaY) > fabs(deltaX)) {
-            pthread_mutex_unlock(&gestureMutex);
-            return;
-        }
-
-		bool triggered = false;
-		if (avgVelX > SWIPE_VELOCITY_THRESHOLD) {
-			consecutiveRightFrames++;
-			consecutiveLeftFrames = 0;
-			if (consecutiveRightFrames >= 2) {
-				NSLog(@"Right swipe (by velocity) detected.\n");
-				switch_workspace(config.swipe_right);
-				triggered = true;
-				consecutiveRightFrames = 0;
-			}
-		} else if (avgVelX < -SWIPE_VELOCITY_THRESHOLD) {
-			consecutiveLeftFrames++;
-			consecutiveRightFrames = 0;
-			if (consecutiveLeftFrames >= 2) {
-				NSLog(@"Left swipe (by velocity) detected.\n");
-				switch_workspace(config.swipe_left);
-				triggered = true;
-				consecutiveLeftFrames = 0;
-			}
-		} else if (deltaX > SWIPE_THRESHOLD) {
-			NSLog(@"Right swipe (by position) detected.\n");
-			switch_workspace(config.swipe_right);
-			triggered = true;
-		} else if (deltaX < -SWIPE_THRESHOLD) {
-			NSLog(@"Left swipe (by position) detected.\n");
-			switch_workspace(config.swipe_left);
-			triggered = true;
-		}
+static void aerospace_connected(Aerospace* connected)
+{
+	atomic_store_explicit(&client, connected, memory_order_release);
+	stats_phase_done(PHASE_AEROSPACE);
+}
 
-		if (triggered) {
-			lastSwipeTime = contacts[0].timestamp;
-			swiping = false;
-		}
+static void gestureCallback(const touch_frame* frame, swipe_modifier modifier, uint64_t event_ns,
+	uint64_t dispatched_ns)
+{
+	uint64_t span = trace_begin();
+	uint64_t start = stats_now_ns();
+	stats_record(STAGE_DISPATCH, start - dispatched_ns);
+	stats_count(COUNTER_FRAMES);
+	stats_phase_done(PHASE_FIRST_FRAME);
+
+	gesture_device* device = devices_get(frame->device);
+	if (!device) {
+		stats_count(COUNTER_DROPS);
+		trace_end("gestureCallback", span);
+		return;
+	}
+	if (recording)
+		record_frame(frame);
+
+	/* only frames of the same trackpad wait on each other, and only for the
+	 * recognizer; the event tap's prefilter takes the same lock */
+	/* pinned until the binding's command is done, whatever reloads meanwhile */
+	const Config* config = config_acquire();
+	pthread_mutex_lock(&device->lock);
+	const Binding* binding = recognizer_feed(&device->gesture, config, frame, modifier);
+	pthread_mutex_unlock(&device->lock);
+	stats_record(STAGE_RECOGNITION, stats_now_ns() - start);
+
+	if (binding) {
+		if (device->haptics && config->haptic && config->haptic_policy == HAPTIC_ON_RECOGNITION)
+			haptic_queue_post(device->haptics, 3);
+		run_binding(device->haptics, config, binding, event_ns);
 	}
+	config_release(config);
+
+	trace_end("gestureCallback", span);
+}
 
-	pthread_mutex_unlock(&gestureMutex);
+/* Whether the device's recognizer rejects a frame of count contacts on the
+ * count and cooldown alone, before any of them is converted. A device with
+ * earlier frames still queued, or busy with one, is not waited for; its
+ * frame is converted and fed as usual. */
+static bool prefilter(device_queue* queue, uint64_t device_id, int count, double now)
+{
+	/* a recording wants every frame */
+	if (recording || atomic_load(&queue->pending) != 0)
+		return false;
+	gesture_device* device = devices_get(device_id);
+	if (!device || pthread_mutex_trylock(&device->lock) != 0)
+		return false;
+	const Config* config = config_acquire();
+	bool rejected = recognizer_prefilter(&device->gesture, config, count, now);
+	config_release(config);
+	pthread_mutex_unlock(&device->lock);
+	return rejected;
 }
 
 static CGEventRef key_handler(CGEventTapProxy proxy,
@@ -137,39 +239,110 @@ static CGEventRef key_handler(CGEventTapProxy proxy,
 	void* reference)
 {
 	if (!AXIsProcessTrusted()) {
-		NSLog(@"Accessibility permission lost. Disabling event tap to allow system events.");
+		log_warn("Accessibility permission lost. Disabling event tap to allow system events.");
 		event_tap_end((struct event_tap*)reference);
 		return event;
 	}
 
 	switch (type) {
 	case kCGEventTapDisabledByTimeout:
-		NSLog(@"Timeout.\n");
+		log_warn("Event tap timed out.");
 	case kCGEventTapDisabledByUserInput:
-		NSLog(@"Re‐enabling event tap.\n");
+		log_warn("Re-enabling event tap.");
 		CGEventTapEnable(((struct event_tap*)reference)->handle, true);
 		break;
 	case NSEventTypeGesture: {
+		if (atomic_load_explicit(&standby, memory_order_acquire))
+			return event;
+		uint64_t span = trace_begin();
+		uint64_t received_ns = stats_now_ns();
+		uint64_t event_ns = event_time_ns(event);
+		stats_record(STAGE_EVENT_TAP, received_ns > event_ns ? received_ns - event_ns : 0);
+
 		NSEvent* nsEvent = [NSEvent eventWithCGEvent:event];
 		NSSet<NSTouch*>* touches = nsEvent.allTouches;
 		NSUInteger count = touches.count;
 
-		if (count == 0)
+		if (count == 0) {
+			trace_end("key_handler", span);
 			return event;
+		}
 
-		touch* nativeTouches = malloc(sizeof(touch) * count);
-		if (nativeTouches == NULL)
+		/* the set keeps the touches alive for the rest of the callback */
+		NSTouch** all = malloc(sizeof(NSTouch*) * count);
+		uint64_t* owners = malloc(sizeof(uint64_t) * count);
+		if (all == NULL || owners == NULL) {
+			free(all);
+			free(owners);
+			stats_count(COUNTER_DROPS);
+			trace_end("key_handler", span);
 			return event;
-
+		}
 		NSUInteger i = 0;
-		for (NSTouch* aTouch in touches)
-			nativeTouches[i++] = [TouchConverter convert_nstouch:aTouch];
+		for (NSTouch* aTouch in touches) {
+			all[i] = aTouch;
+			owners[i++] = touch_device_id(aTouch);
+		}
 
-		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-			gestureCallback(nativeTouches, count);
-			free(nativeTouches);
-		});
+		uint64_t convert_span = trace_begin();
+		[TouchConverter next_frame];
+		swipe_modifier modifier = modifier_from_flags(CGEventGetFlags(event));
+		/* one frame per trackpad, nearly always just the one */
+		for (NSUInteger start = 0, end; start < count; start = end) {
+			uint64_t device_id = owners[start];
+			end = start;
+			for (NSUInteger k = start; k < count; ++k) {
+				if (owners[k] != device_id)
+					continue;
+				NSTouch* moved = all[end];
+				all[end] = all[k];
+				all[k] = moved;
+				owners[k] = owners[end];
+				owners[end++] = device_id;
+			}
+			NSUInteger frame_count = end - start;
+
+			device_queue* queue = device_queue_for(device_id);
+			if (!queue) {
+				stats_count(COUNTER_DROPS);
+				continue;
+			}
+			/* the time the converted frame would carry, its first touch's */
+			double now = [[all[start] valueForKey:@"timestamp"] doubleValue];
+			if (prefilter(queue, device_id, (int)frame_count, now)) {
+				stats_count(COUNTER_FRAMES);
+				stats_count(COUNTER_PREFILTERED);
+				stats_add(COUNTER_UNCONVERTED, frame_count);
+				continue;
+			}
+
+			void* block;
+			if (posix_memalign(&block, 64, sizeof(touch_frame)) != 0) {
+				stats_count(COUNTER_DROPS);
+				continue;
+			}
+			touch_frame* frame = block;
+			uint64_t convert_start = stats_now_ns();
+			touch_frame_init(frame, device_id, now);
+			for (NSUInteger k = 0; k < frame_count; ++k) {
+				touch converted = [TouchConverter convert_nstouch:all[start + k]];
+				touch_frame_add(frame, &converted);
+			}
+			uint64_t dispatched_ns = stats_now_ns();
+			stats_record(STAGE_TOUCH_CONVERT, dispatched_ns - convert_start);
+
+			atomic_fetch_add(&queue->pending, 1);
+			dispatch_async(queue->queue, ^{
+				gestureCallback(frame, modifier, event_ns, dispatched_ns);
+				free(frame);
+				atomic_fetch_sub(&queue->pending, 1);
+			});
+		}
+		trace_end("convert_nstouch", convert_span);
+		free(all);
+		free(owners);
 
+		trace_end("key_handler", span);
 		return event;
 	}
 	}
@@ -177,19 +350,23 @@ static CGEventRef key_handler(CGEventTapProxy proxy,
 	return event;
 }
 
-static void acquire_lockfile(void)
+/* False when another instance holds the lock and wait is not set. */
+static bool acquire_lockfile(bool wait)
 {
-	char* user = getenv("USER");
-	if (!user)
-		printf("Error: User variable not set.\n"), exit(1);
+	static int handle = -1;
+	if (handle == -1) {
+		char* user = getenv("USER");
+		if (!user)
+			printf("Error: User variable not set.\n"), exit(1);
 
-	char buffer[256];
-	snprintf(buffer, 256, "/tmp/aerospace-swipe-%s.lock", user);
+		char buffer[256];
+		snprintf(buffer, 256, "/tmp/aerospace-swipe-%s.lock", user);
 
-	int handle = open(buffer, O_CREAT | O_WRONLY, 0600);
-	if (handle == -1) {
-		printf("Error: Could not create lock-file.\n");
-		exit(1);
+		handle = open(buffer, O_CREAT | O_WRONLY, 0600);
+		if (handle == -1) {
+			printf("Error: Could not create lock-file.\n");
+			exit(1);
+		}
 	}
 
 	struct flock lockfd = {
@@ -200,9 +377,120 @@ static void acquire_lockfile(void)
 		.l_whence = SEEK_SET
 	};
 
-	if (fcntl(handle, F_SETLK, &lockfd) == -1) {
-		printf("Error: Could not acquire lock-file.\naerospace-swipe already running?\n");
-		exit(1);
+	while (fcntl(handle, wait ? F_SETLKW : F_SETLK, &lockfd) == -1)
+		if (!wait || errno != EINTR)
+			return false;
+	return true;
+}
+
+/* The running instance's side of a hot restart. */
+static bool release_for_handoff(handoff_state* state)
+{
+	executor_pause();
+	state->device_count = devices_save(state->devices, MAX_DEVICES);
+	state->aerospace_fd = aerospace_fd(atomic_load(&client));
+	return true;
+}
+
+static void resume_after_handoff(void)
+{
+	executor_resume();
+}
+
+static void exit_after_handoff(void)
+{
+	NSLog(@"Handed over to the new instance, exiting.");
+	log_flush();
+	exit(0);
+}
+
+static void serve_handoff(void)
+{
+	static const handoff_hooks hooks = { release_for_handoff, resume_after_handoff, exit_after_handoff };
+	char* path = handoff_socket_path();
+	if (path)
+		handoff_serve(path, &hooks);
+	free(path);
+}
+
+/* Gestures and actions injected over the control socket, run as
+ * gestureCallback runs what it recognizes. */
+static void run_injected(gesture_device* device, const Config* config, const Binding* binding,
+	uint64_t event_ns)
+{
+	if (device->haptics && config->haptic && config->haptic_policy == HAPTIC_ON_RECOGNITION)
+		haptic_queue_post(device->haptics, 3);
+	run_binding(device->haptics, config, binding, event_ns);
+}
+
+static void add_status(cJSON* reply)
+{
+	cJSON_AddBoolToObject(reply, "aerospace", aerospace_is_initialized(atomic_load(&client)));
+	cJSON_AddBoolToObject(reply, "recording", recording != NULL);
+	char* path = config_path();
+	if (path)
+		cJSON_AddStringToObject(reply, "config_path", path);
+	free(path);
+}
+
+static void serve_control(void)
+{
+	static const control_hooks hooks = { config_acquire, config_release, config_reload, run_injected, add_status };
+	char* path = control_socket_path();
+	if (path)
+		control_server_start(path, &hooks);
+	free(path);
+}
+
+/* The new instance's side: everything but the aerospace connection is up
+ * and the event tap is in standby. Takes the connection and the gesture
+ * state, lets the old instance go and inherits its lock. */
+static void take_over(int conn)
+{
+	handoff_state state;
+	if (!handoff_take(conn, &state)) {
+		fprintf(stderr, "Error: The running instance did not hand over.\n");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < state.device_count; ++i)
+		devices_restore(&state.devices[i]);
+	if (state.aerospace_fd >= 0)
+		aerospace_connected(aerospace_adopt(state.aerospace_fd, NULL));
+	else
+		aerospace_connect_async(NULL, aerospace_connected);
+	atomic_store_explicit(&standby, false, memory_order_release);
+	handoff_confirm(conn);
+	log_info("Took over %d device(s) from the running instance.", state.device_count);
+
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+		acquire_lockfile(true);
+	});
+}
+
+/* A display added, removed or rearranged changes aerospace's monitors, and
+ * with them which workspaces each one has. */
+static void displays_changed(CGDirectDisplayID display, CGDisplayChangeSummaryFlags flags, void* context)
+{
+	(void)display;
+	(void)context;
+	if (flags & kCGDisplayBeginConfigurationFlag)
+		return;
+	if (flags & (kCGDisplayAddFlag | kCGDisplayRemoveFlag | kCGDisplayMovedFlag | kCGDisplayDesktopShapeChangedFlag))
+		executor_forget_workspaces();
+}
+
+/* Without an actuator gestures still work, only without feedback. */
+static void open_default_haptics(void)
+{
+	CFTypeRef actuator = haptic_open_default(&haptics_device);
+	if (!actuator) {
+		log_warn("No haptic actuator found, running without haptics.");
+		return;
+	}
+	haptics = haptic_queue_start(haptic_mt_backend(actuator));
+	if (!haptics) {
+		log_warn("Failed to start the haptic queue, running without haptics.");
+		haptic_close(actuator);
 	}
 }
 
@@ -222,10 +510,22 @@ void waitForAccessibilityAndRestart(void)
 
 int main(int argc, const char* argv[])
 {
+	stats_startup_begin();
 	signal(SIGCHLD, SIG_IGN);
 	signal(SIGPIPE, SIG_IGN);
 
-	acquire_lockfile();
+	/* a running instance is restarted hot: it hands its aerospace
+	 * connection and gesture state over once this one is ready */
+	int takeover = -1;
+	if (!acquire_lockfile(false)) {
+		char* handoff_path = handoff_socket_path();
+		takeover = handoff_path ? handoff_connect(handoff_path) : -1;
+		free(handoff_path);
+		if (takeover < 0) {
+			printf("Error: Could not acquire lock-file.\naerospace-swipe already running?\n");
+			exit(1);
+		}
+	}
 
 	@autoreleasepool {
 		NSDictionary* options = @{(__bridge id)kAXTrustedCheckOptionPrompt : @YES};
@@ -243,20 +543,58 @@ int main(int argc, const char* argv[])
 
 		NSLog(@"Accessibility permission granted. Continuing app initialization...");
 
-		config = load_config();
-		client = aerospace_new(NULL);
-		if (!client) {
-			fprintf(stderr, "Error: Failed to initialize Aerospace client.\n");
-			exit(EXIT_FAILURE);
-		}
-		haptic = haptic_open_default();
-		if (!haptic) {
-			fprintf(stderr, "Error: Failed to initialize haptic actuator.\n");
-			aerospace_close(client);
-			exit(EXIT_FAILURE);
-		}
+		log_start();
+		trace_start();
+		char* stats_path = stats_socket_path();
+		if (stats_path)
+			stats_server_start(stats_path);
+		free(stats_path);
+
+		/* aerospace may well not be up yet at login; gestures are recognized
+		 * from the start and their commands dropped until it is */
+		if (takeover < 0)
+			aerospace_connect_async(NULL, aerospace_connected);
+
+		/* the input path needs both, neither needs the other */
+		dispatch_group_t startup = dispatch_group_create();
+		dispatch_group_async(startup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+			config_init();
+			stats_phase_done(PHASE_CONFIG);
+		});
+		dispatch_group_async(startup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+			open_default_haptics();
+			stats_phase_done(PHASE_HAPTICS);
+		});
+		dispatch_group_wait(startup, DISPATCH_TIME_FOREVER);
+		dispatch_release(startup);
+
+		start_recording();
+		config_watch_start();
+		devices_init(open_device_haptics);
+		CGDisplayRegisterReconfigurationCallback(displays_changed, NULL);
+
+		/* kill -USR1 dumps the flight recorder; the dispatch source runs the
+		 * dump on a queue rather than inside the signal handler */
+		signal(SIGUSR1, SIG_IGN);
+		dispatch_source_t dump_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, SIGUSR1, 0,
+			dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+		dispatch_source_set_event_handler(dump_source, ^{
+			char* path = flight_recorder_path();
+			if (path && flight_recorder_dump(path))
+				NSLog(@"Flight recorder written to %s", path);
+			else
+				NSLog(@"Failed to write flight recorder.");
+			free(path);
+		});
+		dispatch_resume(dump_source);
 
+		atomic_store(&standby, takeover >= 0);
 		event_tap_begin(&g_event_tap, key_handler);
+		stats_phase_done(PHASE_INPUT);
+		if (takeover >= 0)
+			take_over(takeover);
+		serve_handoff();
+		serve_control();
 
 		return NSApplicationMain(argc, argv);
 	}
@@ -0,0 +1,423 @@
+#include "recognizer.h"
+#include "flight_recorder.h"
+#include "log.h"
+#include <math.h>
+#include <string.h>
+
+/* prediction only looks at the last 100ms of the trajectory, needs four
+ * samples to judge a fit, and never fires before a third of the travel */
+#define PREDICT_WINDOW 0.1
+#define PREDICT_MIN_SAMPLES 4
+#define PREDICT_MIN_TRAVEL(swipe) ((swipe) / 3)
+
+static const char* const direction_labels[SWIPE_DIRECTIONS] = { "Left", "Right", "Up", "Down" };
+
+/* the flight recorder is shared by every recognizer in the process, so
+ * offline sweeps running many of them in parallel leave it alone */
+#define record_event(state, ...) \
+	do { \
+		if (!(state)->quiet) \
+			flight_record_event(__VA_ARGS__); \
+	} while (0)
+
+void recognizer_init(recognizer* state)
+{
+	memset(state, 0, sizeof(*state));
+	state->grace_since = -1.0;
+	state->last_swipe_time = -HUGE_VAL;
+}
+
+static void push_history(recognizer* state, double t, float x)
+{
+	state->history_t[state->history_next] = t;
+	state->history_x[state->history_next] = x;
+	state->history_next = (state->history_next + 1) % RECOGNIZER_HISTORY;
+	if (state->history_count < RECOGNIZER_HISTORY)
+		state->history_count++;
+}
+
+/* Fit x = a + b*t to the recent displacement samples and extrapolate horizon
+ * seconds ahead. Returns the predicted displacement from the gesture start,
+ * or 0 when the fit is too short or too poor (R^2 below confidence) to trust. */
+static float predicted_delta(const recognizer* state, const prediction* params)
+{
+	int last = (state->history_next + RECOGNIZER_HISTORY - 1) % RECOGNIZER_HISTORY;
+	double now = state->history_t[last];
+
+	double st = 0.0, sx = 0.0;
+	int n = 0;
+	for (int i = 0; i < state->history_count; ++i) {
+		int k = (last + RECOGNIZER_HISTORY - i) % RECOGNIZER_HISTORY;
+		if (now - state->history_t[k] > PREDICT_WINDOW)
+			break;
+		st += state->history_t[k] - now;
+		sx += state->history_x[k];
+		n++;
+	}
+	if (n < PREDICT_MIN_SAMPLES)
+		return 0.0f;
+
+	double mt = st / n, mx = sx / n;
+	double stt = 0.0, stx = 0.0, sxx = 0.0;
+	for (int i = 0; i < n; ++i) {
+		int k = (last + RECOGNIZER_HISTORY - i) % RECOGNIZER_HISTORY;
+		double dt = state->history_t[k] - now - mt;
+		double dx = state->history_x[k] - mx;
+		stt += dt * dt;
+		stx += dt * dx;
+		sxx += dx * dx;
+	}
+	if (stt <= 0.0 || sxx <= 0.0)
+		return 0.0f;
+
+	/* R^2 of a simple regression is the squared correlation */
+	double r2 = (stx * stx) / (stt * sxx);
+	if (r2 < params->confidence)
+		return 0.0f;
+
+	/* the fitted line at the newest sample (t = 0), then horizon further */
+	double slope = stx / stt;
+	double fitted_now = mx - slope * mt;
+	return (float)(fitted_now + slope * params->horizon);
+}
+
+/* Whether the frame holds the tracked contacts, each in the lane it had. */
+static bool contacts_in_place(const recognizer* state, const touch_frame* frame)
+{
+	int n = touch_frame_stored(frame);
+	if (n != state->tracked)
+		return false;
+	for (int i = 0; i < n; ++i)
+		if (state->ids[i] != frame->id[i])
+			return false;
+	return true;
+}
+
+/* Mean displacement of the contacts that were already tracked; the others
+ * are adopted as if they had moved as far. The tracked set becomes this
+ * frame's contacts. False when none of them was tracked.
+ *
+ * Each displacement goes in its contact's lane, zero for the rest, and the
+ * lanes are summed like the means are. Origins past tracked are kept zero,
+ * so when every contact kept its lane, as they nearly always do, the
+ * displacements are a single lane-wise subtraction. */
+static bool follow_contacts(recognizer* state, const touch_frame* frame, float* dx, float* dy)
+{
+	int n = touch_frame_stored(frame);
+	int match[RECOGNIZER_CONTACTS];
+	float moved_x[RECOGNIZER_CONTACTS], moved_y[RECOGNIZER_CONTACTS];
+	int found = 0;
+
+	bool in_place = contacts_in_place(state, frame);
+	if (in_place) {
+		for (int i = 0; i < RECOGNIZER_CONTACTS; ++i) {
+			moved_x[i] = frame->x[i] - state->origin_x[i];
+			moved_y[i] = frame->y[i] - state->origin_y[i];
+		}
+		found = n;
+	} else {
+		memset(moved_x, 0, sizeof(moved_x));
+		memset(moved_y, 0, sizeof(moved_y));
+		for (int i = 0; i < n; ++i) {
+			match[i] = -1;
+			for (int j = 0; j < state->tracked; ++j) {
+				if (state->ids[j] == frame->id[i]) {
+					match[i] = j;
+					moved_x[i] = frame->x[i] - state->origin_x[j];
+					moved_y[i] = frame->y[i] - state->origin_y[j];
+					found++;
+					break;
+				}
+			}
+		}
+	}
+
+	float mean_x = found ? touch_frame_sum(moved_x) / found : 0.0f;
+	float mean_y = found ? touch_frame_sum(moved_y) / found : 0.0f;
+	*dx = mean_x;
+	*dy = mean_y;
+	if (in_place)
+		return found > 0;
+
+	float origin_x[RECOGNIZER_CONTACTS] = { 0.0f }, origin_y[RECOGNIZER_CONTACTS] = { 0.0f };
+	for (int i = 0; i < n; ++i) {
+		origin_x[i] = match[i] >= 0 ? state->origin_x[match[i]] : frame->x[i] - mean_x;
+		origin_y[i] = match[i] >= 0 ? state->origin_y[match[i]] : frame->y[i] - mean_y;
+	}
+	memcpy(state->ids, frame->id, sizeof(uint64_t) * n);
+	memcpy(state->origin_x, origin_x, sizeof(origin_x));
+	memcpy(state->origin_y, origin_y, sizeof(origin_y));
+	state->tracked = n;
+	return found > 0;
+}
+
+/* The finger count the frame counts as, or -1 when its count or the
+ * cooldown rules it out. Calling it again for the same frame changes
+ * nothing more. */
+static int gate(recognizer* state, const Config* config, int count, double now)
+{
+	/* a finger lifting or landing mid gesture keeps the gesture, and its
+	 * finger count, until the grace window runs out */
+	int fingers = count;
+	if (state->swiping && count != state->fingers) {
+		float grace = config->thresholds[state->fingers].grace;
+		if (state->grace_since < 0.0) {
+			state->grace_since = now;
+			if (grace > 0.0f)
+				record_event(state, FR_STATE, count, FR_STATE_GRACE, 0, 0, 0);
+		}
+		if (now - state->grace_since < grace)
+			fingers = state->fingers;
+	} else {
+		state->grace_since = -1.0;
+	}
+
+	bool unbound = fingers < MIN_FINGERS || fingers > MAX_FINGERS || !config->fingers_bound[fingers];
+	if (unbound || (now - state->last_swipe_time) < config->thresholds[fingers].cooldown) {
+		if (state->swiping)
+			record_event(state, FR_STATE, count,
+				unbound ? FR_STATE_RESET_FINGERS : FR_STATE_RESET_COOLDOWN, 0, 0, 0);
+		state->swiping = false;
+		state->grace_since = -1.0;
+		return -1;
+	}
+	return fingers;
+}
+
+bool recognizer_prefilter(recognizer* state, const Config* config, int count, double now)
+{
+	return gate(state, config, count, now) < 0;
+}
+
+/* Whether decide can trigger or record anything on a frame. Most frames of
+ * a gesture are short of every threshold and only go into the history. */
+static inline bool may_decide(const Config* config, const thresholds* limits, float avgVelX, float deltaX,
+	float deltaY)
+{
+	if (fabsf(deltaY) > fabsf(deltaX))
+		return fabsf(deltaY) > limits->swipe;
+	return avgVelX > limits->velocity || avgVelX < -limits->velocity || deltaX > limits->swipe
+		|| deltaX < -limits->swipe
+		|| (config->prediction.enabled && fabsf(deltaX) >= PREDICT_MIN_TRAVEL(limits->swipe));
+}
+
+/* The decision on a frame of a gesture under way, once its displacement is
+ * in the history. */
+static inline const Binding* decide(recognizer* state, const Config* config, int count, double now, int fingers,
+	float avgVelX, float deltaX, float deltaY, swipe_modifier modifier)
+{
+	const thresholds* limits = &config->thresholds[fingers];
+	int direction = -1;
+	bool by_velocity = false;
+	bool by_prediction = false;
+
+	/* the velocity estimate is a regression over several samples, so a
+	 * single frame over the threshold is trustworthy on its own */
+	if (fabsf(deltaY) > fabsf(deltaX)) {
+		if (!config->vertical_bound[fingers] || fabsf(deltaY) <= limits->swipe) {
+			if (fabsf(deltaY) > limits->swipe)
+				record_event(state, FR_STATE, count, FR_STATE_VERTICAL, deltaX, deltaY, avgVelX);
+			return NULL;
+		}
+		/* normalized positions grow upwards */
+		direction = deltaY > 0 ? SWIPE_UP : SWIPE_DOWN;
+	} else if (avgVelX > limits->velocity) {
+		direction = SWIPE_RIGHT;
+		by_velocity = true;
+	} else if (avgVelX < -limits->velocity) {
+		direction = SWIPE_LEFT;
+		by_velocity = true;
+	} else if (deltaX > limits->swipe) {
+		direction = SWIPE_RIGHT;
+	} else if (deltaX < -limits->swipe) {
+		direction = SWIPE_LEFT;
+	} else if (config->prediction.enabled && fabsf(deltaX) >= PREDICT_MIN_TRAVEL(limits->swipe)) {
+		/* the movement so far must already point the way of the prediction */
+		float predicted = predicted_delta(state, &config->prediction);
+		if (predicted > limits->swipe && deltaX > 0) {
+			direction = SWIPE_RIGHT;
+			by_prediction = true;
+		} else if (predicted < -limits->swipe && deltaX < 0) {
+			direction = SWIPE_LEFT;
+			by_prediction = true;
+		}
+	}
+
+	/* a direction with nothing bound to it is no trigger: the gesture goes
+	 * on, and a later frame may still cross a bound threshold */
+	const Binding* binding = direction < 0 ? NULL : config_binding(config, fingers, direction, modifier);
+	if (!binding)
+		return NULL;
+
+	log_info("%s swipe (by %s) detected.", direction_labels[direction],
+		by_velocity ? "velocity" : by_prediction ? "prediction" : "position");
+	record_event(state, FR_TRIGGER, fingers,
+		direction | (by_velocity ? FR_BY_VELOCITY : 0) | (by_prediction ? FR_BY_PREDICTION : 0),
+		deltaX, deltaY, avgVelX);
+	state->last_swipe_time = now;
+	state->swiping = false;
+	state->direction = direction;
+	state->predicted = by_prediction;
+	return binding;
+}
+
+/* Everything recognizer_feed does past the gate. The means are only worked
+ * out there, as the gate turns away about a third of the frames of a
+ * typical trace. */
+static inline const Binding* step(recognizer* state, const Config* config, const touch_frame* frame, int fingers,
+	swipe_modifier modifier)
+{
+	double now = frame->timestamp;
+	int count = frame->count;
+	frame_means means = touch_frame_means(frame);
+	const float avgX = means.x;
+	const float avgVelX = means.velocity;
+	const float avgY = means.y;
+	record_event(state, FR_FRAME, count, 0, avgX, avgY, avgVelX);
+
+	float deltaX = 0.0f;
+	float deltaY = 0.0f;
+	bool restart = !state->swiping || fingers != state->fingers
+		|| !follow_contacts(state, frame, &deltaX, &deltaY);
+	if (restart) {
+		record_event(state, FR_STATE, count, state->swiping ? FR_STATE_RESTART : FR_STATE_BEGIN, 0, 0, 0);
+		state->swiping = true;
+		state->fingers = fingers;
+		state->grace_since = -1.0;
+		state->tracked = 0;
+		follow_contacts(state, frame, &deltaX, &deltaY);
+		state->history_count = 0;
+		state->history_next = 0;
+		push_history(state, now, 0.0f);
+		return NULL;
+	}
+	push_history(state, now, deltaX);
+	if (!may_decide(config, &config->thresholds[fingers], avgVelX, deltaX, deltaY))
+		return NULL;
+	return decide(state, config, count, now, fingers, avgVelX, deltaX, deltaY, modifier);
+}
+
+const Binding* recognizer_feed(recognizer* state, const Config* config, const touch_frame* frame,
+	swipe_modifier modifier)
+{
+	int fingers = gate(state, config, frame->count, frame->timestamp);
+	return fingers < 0 ? NULL : step(state, config, frame, fingers, modifier);
+}
+
+/* recognizer_feed_batch works out the means and displacements of this many
+ * frames at once, a vector of each. Longer blocks measured slower: most of
+ * a gesture's frames come after its trigger, which the cooldown turns away. */
+#define BATCH_BLOCK 4
+
+/* Frames that keep the tracked contacts in place. While the gesture goes on
+ * their displacements are from the same origins, so they can be computed
+ * before the gate and decisions reach them. */
+typedef struct {
+	size_t start, end; /* frames of the batch, [start, end) */
+	float x[BATCH_BLOCK];
+	float y[BATCH_BLOCK];
+	float velocity[BATCH_BLOCK];
+	float dx[BATCH_BLOCK];
+	float dy[BATCH_BLOCK];
+} batch_block;
+
+/* The same lane arithmetic as touch_frame_means and follow_contacts'
+ * in-place case, so the results are identical bit for bit; a full block is
+ * reduced four frames to a vector where touch_frame_sum4 is available.
+ * Every frame of the block stores state->tracked > 0 contacts. */
+static void fill_block(batch_block* block, const recognizer* state, const touch_frame* frames)
+{
+	const touch_frame* q = &frames[block->start];
+#if defined(TOUCH_FRAME_SUM4)
+	if (block->end - block->start == BATCH_BLOCK) {
+		frame_lanes4 x = touch_frame_sum4(touch_frame_fold(q[0].x, NULL), touch_frame_fold(q[1].x, NULL),
+			touch_frame_fold(q[2].x, NULL), touch_frame_fold(q[3].x, NULL));
+		frame_lanes4 y = touch_frame_sum4(touch_frame_fold(q[0].y, NULL), touch_frame_fold(q[1].y, NULL),
+			touch_frame_fold(q[2].y, NULL), touch_frame_fold(q[3].y, NULL));
+		frame_lanes4 v = touch_frame_sum4(touch_frame_fold(q[0].velocity, NULL),
+			touch_frame_fold(q[1].velocity, NULL), touch_frame_fold(q[2].velocity, NULL),
+			touch_frame_fold(q[3].velocity, NULL));
+		frame_lanes4 dx = touch_frame_sum4(touch_frame_fold(q[0].x, state->origin_x),
+			touch_frame_fold(q[1].x, state->origin_x), touch_frame_fold(q[2].x, state->origin_x),
+			touch_frame_fold(q[3].x, state->origin_x));
+		frame_lanes4 dy = touch_frame_sum4(touch_frame_fold(q[0].y, state->origin_y),
+			touch_frame_fold(q[1].y, state->origin_y), touch_frame_fold(q[2].y, state->origin_y),
+			touch_frame_fold(q[3].y, state->origin_y));
+		float n = (float)state->tracked;
+		x /= n;
+		y /= n;
+		v /= n;
+		dx /= n;
+		dy /= n;
+		__builtin_memcpy(block->x, &x, sizeof(x));
+		__builtin_memcpy(block->y, &y, sizeof(y));
+		__builtin_memcpy(block->velocity, &v, sizeof(v));
+		__builtin_memcpy(block->dx, &dx, sizeof(dx));
+		__builtin_memcpy(block->dy, &dy, sizeof(dy));
+		return;
+	}
+#endif
+	for (size_t i = 0; i < block->end - block->start; ++i) {
+		frame_means means = touch_frame_means(&q[i]);
+		float moved_x[RECOGNIZER_CONTACTS], moved_y[RECOGNIZER_CONTACTS];
+		for (int c = 0; c < RECOGNIZER_CONTACTS; ++c) {
+			moved_x[c] = q[i].x[c] - state->origin_x[c];
+			moved_y[c] = q[i].y[c] - state->origin_y[c];
+		}
+		block->x[i] = means.x;
+		block->y[i] = means.y;
+		block->velocity[i] = means.velocity;
+		block->dx[i] = touch_frame_sum(moved_x) / state->tracked;
+		block->dy[i] = touch_frame_sum(moved_y) / state->tracked;
+	}
+}
+
+size_t recognizer_feed_batch(recognizer* state, const Config* config, const touch_frame* frames,
+	size_t count, swipe_modifier modifier, recognizer_trigger* triggers, size_t max_triggers)
+{
+	batch_block block;
+	block.start = block.end = 0;
+	size_t fired = 0;
+	for (size_t f = 0; f < count; ++f) {
+		const touch_frame* frame = &frames[f];
+		double now = frame->timestamp;
+		int fingers = gate(state, config, frame->count, now);
+		if (fingers < 0)
+			continue;
+
+		bool going_on = state->swiping && fingers == state->fingers;
+		if (going_on && f >= block.end && contacts_in_place(state, frame)) {
+			block.start = f;
+			block.end = f + 1;
+			while (block.end < count && block.end - block.start < BATCH_BLOCK
+				&& contacts_in_place(state, &frames[block.end]))
+				block.end++;
+			fill_block(&block, state, frames);
+		}
+
+		const Binding* binding = NULL;
+		if (going_on && f < block.end) {
+			size_t i = f - block.start;
+			record_event(state, FR_FRAME, frame->count, 0, block.x[i], block.y[i], block.velocity[i]);
+			push_history(state, now, block.dx[i]);
+			if (may_decide(config, &config->thresholds[fingers], block.velocity[i], block.dx[i], block.dy[i]))
+				binding = decide(state, config, frame->count, now, fingers, block.velocity[i], block.dx[i],
+					block.dy[i], modifier);
+		} else {
+			/* the origins may move, which leaves the block behind */
+			block.end = 0;
+			binding = step(state, config, frame, fingers, modifier);
+		}
+		if (!binding)
+			continue;
+		if (fired < max_triggers) {
+			recognizer_trigger* trigger = &triggers[fired];
+			trigger->frame = f;
+			trigger->binding = binding;
+			trigger->direction = state->direction;
+			trigger->predicted = state->predicted;
+		}
+		fired++;
+	}
+	return fired;
+}
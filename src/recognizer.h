@@ -0,0 +1,68 @@
+#pragma once
+#include "config.h"
+#include "touch_frame.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The swipe recognizer, free of AppKit so it can be replayed and measured on
+ * any platform. */
+
+/* displacement samples kept for the trajectory fit */
+#define RECOGNIZER_HISTORY 8
+/* contacts followed through one gesture */
+#define RECOGNIZER_CONTACTS FRAME_CONTACTS
+
+typedef struct {
+	bool swiping;
+	int fingers;
+	/* where each contact of the gesture started; one that lands mid gesture
+	 * is given the displacement the others already have, so a finger
+	 * lifting or landing doesn't move the gesture */
+	uint64_t ids[RECOGNIZER_CONTACTS];
+	float origin_x[RECOGNIZER_CONTACTS];
+	float origin_y[RECOGNIZER_CONTACTS];
+	int tracked;
+	double grace_since; /* when the finger count left fingers, or -1 */
+	double last_swipe_time;
+	/* horizontal displacement of the current gesture, a ring of samples */
+	double history_t[RECOGNIZER_HISTORY];
+	float history_x[RECOGNIZER_HISTORY];
+	int history_count;
+	int history_next;
+	/* the last trigger, for replay and diagnostics */
+	swipe_direction direction;
+	bool predicted;
+	bool quiet; /* keep decisions out of the flight recorder */
+} recognizer;
+
+void recognizer_init(recognizer* state);
+
+/* Whether a frame of count contacts at now is rejected on its finger count
+ * or the cooldown alone, which needs none of its contacts, so callers can
+ * skip converting them. A rejected frame leaves the state as feeding it
+ * would have and must not be fed too; one that passes is fed as usual.
+ * Frames must reach it in order, each after every earlier frame of the
+ * device has been fed. */
+bool recognizer_prefilter(recognizer* state, const Config* config, int count, double now);
+
+/* Feed one frame and return the binding it triggers, if any. A frame that
+ * triggers starts the cooldown. */
+const Binding* recognizer_feed(recognizer* state, const Config* config, const touch_frame* frame,
+	swipe_modifier modifier);
+
+typedef struct {
+	size_t frame; /* index in the batch */
+	const Binding* binding;
+	swipe_direction direction;
+	bool predicted;
+} recognizer_trigger;
+
+/* Feed count consecutive frames of one device, for replaying large
+ * corpora. Runs of frames that keep their contacts in place have their
+ * means and displacements computed together, four frames to a vector,
+ * ahead of the gate and decisions, which stay frame by frame; the results
+ * are bit for bit those of recognizer_feed. The first max_triggers
+ * triggers are written to triggers; returns how many there were in all. */
+size_t recognizer_feed_batch(recognizer* state, const Config* config, const touch_frame* frames,
+	size_t count, swipe_modifier modifier, recognizer_trigger* triggers, size_t max_triggers);
@@ -0,0 +1,206 @@
+#include "replay.h"
+#include "contact_table.h"
+#include "recognizer.h"
+#include "touch_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* frames per recognizer_feed_batch call, which can trigger on each */
+#define REPLAY_CHUNK 1024
+
+static bool grow(void** items, size_t* cap, size_t needed, size_t size)
+{
+	if (needed <= *cap)
+		return true;
+	size_t next = *cap ? *cap * 2 : 256;
+	while (next < needed)
+		next *= 2;
+	void* grown = realloc(*items, next * size);
+	if (!grown)
+		return false;
+	*items = grown;
+	*cap = next;
+	return true;
+}
+
+/* realloc only promises malloc's alignment */
+static bool grow_frames(replay_corpus* corpus, size_t needed)
+{
+	if (needed <= corpus->frame_cap)
+		return true;
+	size_t next = corpus->frame_cap ? corpus->frame_cap * 2 : 256;
+	while (next < needed)
+		next *= 2;
+	void* grown;
+	if (posix_memalign(&grown, 64, next * sizeof(touch_frame)) != 0)
+		return false;
+	if (corpus->frame_count)
+		memcpy(grown, corpus->frames, corpus->frame_count * sizeof(touch_frame));
+	free(corpus->frames);
+	corpus->frames = grown;
+	size_t cap = corpus->frame_cap;
+	if (!grow((void**)&corpus->frame_gestures, &cap, next, sizeof(int)))
+		return false;
+	corpus->frame_cap = next;
+	return true;
+}
+
+bool replay_corpus_load(replay_corpus* corpus, const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Error: cannot open %s\n", path);
+		return false;
+	}
+
+	trace_reader reader;
+	touch_trace_reader_init(&reader, file, path);
+	contact_table contacts;
+	contact_table_init(&contacts);
+
+	int file_index = corpus->files++;
+	int local_gesture = -1;
+	bool ok = true;
+	trace_frame frame;
+	while (ok && touch_trace_next(&reader, &frame)) {
+		if (frame.gesture != local_gesture) {
+			local_gesture = frame.gesture;
+			ok = grow((void**)&corpus->gestures, &corpus->gesture_cap, corpus->gesture_count + 1,
+				sizeof(replay_gesture));
+			if (!ok)
+				break;
+			replay_gesture* gesture = &corpus->gestures[corpus->gesture_count++];
+			gesture->label = frame.label;
+			gesture->file = file_index;
+			gesture->start = frame.count ? frame.touches[0].timestamp : 0.0;
+		}
+
+		/* the live path never sees a frame without contacts */
+		if (frame.count == 0)
+			continue;
+		ok = grow_frames(corpus, corpus->frame_count + 1);
+		if (!ok)
+			break;
+
+		size_t index = corpus->frame_count++;
+		corpus->frame_gestures[index] = (int)corpus->gesture_count - 1;
+		touch_frame* out = &corpus->frames[index];
+		touch_frame_init(out, (uint64_t)file_index, 0.0);
+
+		contact_table_next_frame(&contacts);
+		for (int i = 0; i < frame.count; ++i) {
+			const touch* in = &frame.touches[i];
+			touch converted = contact_table_convert(&contacts, in->id, in->x, in->y, in->phase, in->timestamp);
+			touch_frame_add(out, &converted);
+		}
+	}
+
+	fclose(file);
+	if (!ok)
+		fprintf(stderr, "Error: out of memory loading %s\n", path);
+	return ok;
+}
+
+void replay_corpus_free(replay_corpus* corpus)
+{
+	free(corpus->frames);
+	free(corpus->frame_gestures);
+	free(corpus->gestures);
+	memset(corpus, 0, sizeof(*corpus));
+}
+
+void replay_run(const replay_corpus* corpus, const Config* config, replay_outcome* outcomes)
+{
+	for (size_t g = 0; g < corpus->gesture_count; ++g) {
+		outcomes[g].direction = -1;
+		outcomes[g].predicted = false;
+		outcomes[g].latency = 0.0;
+	}
+
+	recognizer state;
+	recognizer_trigger triggers[REPLAY_CHUNK];
+	size_t end;
+	for (size_t first = 0; first < corpus->frame_count; first = end) {
+		/* each file is replayed from a fresh recognizer */
+		int file = corpus->gestures[corpus->frame_gestures[first]].file;
+		end = first;
+		while (end < corpus->frame_count && corpus->gestures[corpus->frame_gestures[end]].file == file)
+			end++;
+		recognizer_init(&state);
+		state.quiet = true;
+
+		for (size_t chunk = first; chunk < end; chunk += REPLAY_CHUNK) {
+			size_t n = end - chunk < REPLAY_CHUNK ? end - chunk : REPLAY_CHUNK;
+			size_t fired = recognizer_feed_batch(&state, config, &corpus->frames[chunk], n, MODIFIER_NONE,
+				triggers, REPLAY_CHUNK);
+			for (size_t t = 0; t < fired; ++t) {
+				size_t f = chunk + triggers[t].frame;
+				int g = corpus->frame_gestures[f];
+				replay_outcome* outcome = &outcomes[g];
+				if (outcome->direction < 0) {
+					outcome->direction = triggers[t].direction;
+					outcome->predicted = triggers[t].predicted;
+					outcome->latency = corpus->frames[f].timestamp - corpus->gestures[g].start;
+				}
+			}
+		}
+	}
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+replay_score replay_score_outcomes(const replay_corpus* corpus, const replay_outcome* outcomes,
+	const replay_outcome* reference)
+{
+	replay_score score;
+	memset(&score, 0, sizeof(score));
+
+	double* latencies = malloc(sizeof(double) * (corpus->gesture_count + 1));
+	int n = 0;
+
+	for (size_t g = 0; g < corpus->gesture_count; ++g) {
+		int truth = corpus->gestures[g].label;
+		if (truth == TRACE_UNLABELLED) {
+			if (!reference)
+				continue;
+			truth = reference[g].direction < 0 ? TRACE_NONE : reference[g].direction;
+		}
+
+		const replay_outcome* outcome = &outcomes[g];
+		if (truth == TRACE_NONE) {
+			score.nones++;
+			if (outcome->direction >= 0)
+				score.false_positives++;
+			continue;
+		}
+
+		score.swipes++;
+		if (outcome->direction < 0) {
+			score.missed++;
+		} else if (outcome->direction != truth) {
+			score.wrong++;
+		} else {
+			score.detected++;
+			score.predicted += outcome->predicted;
+			if (latencies)
+				latencies[n++] = outcome->latency * 1e3;
+		}
+	}
+
+	if (latencies && n > 0) {
+		double sum = 0.0;
+		for (int i = 0; i < n; ++i)
+			sum += latencies[i];
+		qsort(latencies, n, sizeof(double), compare_double);
+		score.mean_ms = sum / n;
+		score.p50_ms = latencies[n / 2];
+		score.p90_ms = latencies[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1];
+	}
+	free(latencies);
+	return score;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "config.h"
+#include "touch_frame.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Recorded traces loaded into memory and replayed through the recognizer.
+ * Touches go through the same contact table and velocity estimator as the
+ * live path once, at load time, so replaying under many configs only costs
+ * the recognizer itself. Frames are stored back to back in the layout the
+ * recognizer reads, cache-line aligned. */
+
+typedef struct {
+	int label; /* TRACE_NONE, TRACE_UNLABELLED or a swipe_direction */
+	int file;
+	double start; /* timestamp of its first frame */
+} replay_gesture;
+
+typedef struct {
+	touch_frame* frames;
+	int* frame_gestures; /* gesture index of each frame */
+	size_t frame_count, frame_cap;
+	replay_gesture* gestures;
+	size_t gesture_count, gesture_cap;
+	int files;
+} replay_corpus;
+
+/* First trigger of one gesture. */
+typedef struct {
+	int direction; /* -1 when nothing fired */
+	bool predicted;
+	double latency; /* seconds from the gesture's first frame */
+} replay_outcome;
+
+typedef struct {
+	int swipes; /* gestures that should trigger */
+	int nones; /* gestures that must not */
+	int detected;
+	int wrong; /* fired the other way */
+	int missed;
+	int false_positives;
+	int predicted; /* detections made by prediction */
+	double mean_ms; /* time to trigger over detections */
+	double p50_ms;
+	double p90_ms;
+} replay_score;
+
+/* Append one trace file; false if it cannot be read. */
+bool replay_corpus_load(replay_corpus* corpus, const char* path);
+void replay_corpus_free(replay_corpus* corpus);
+
+/* outcomes has one entry per gesture. */
+void replay_run(const replay_corpus* corpus, const Config* config, replay_outcome* outcomes);
+
+/* Score against the labels. An unlabelled gesture is scored against
+ * reference, typically the outcome of the stock config, and skipped when
+ * reference is NULL. */
+replay_score replay_score_outcomes(const replay_corpus* corpus, const replay_outcome* outcomes,
+	const replay_outcome* reference);
@@ -0,0 +1,264 @@
+#include "stats.h"
+#include "cJSON.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Log-linear buckets in the spirit of HdrHistogram: 16 linear sub-buckets per
+ * power of two keeps every recorded value within ~6% of the truth, and 37
+ * magnitudes reach past a minute in nanoseconds. */
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define MAGNITUDES 37
+#define BUCKETS ((MAGNITUDES + 1) * SUB_BUCKETS)
+
+typedef struct {
+	_Atomic uint64_t buckets[BUCKETS];
+	_Atomic uint64_t max;
+} histogram;
+
+static histogram histograms[STAGE_COUNT];
+static _Atomic uint64_t counters[COUNTER_COUNT];
+static _Atomic uint64_t start_ns = 0;
+/* when each phase was done, 0 until it is */
+static _Atomic uint64_t phases_ns[PHASE_COUNT];
+
+static const char* const stage_names[STAGE_COUNT] = {
+	"event_tap", "touch_convert", "dispatch", "recognition",
+	"list_query", "switch_command", "haptic", "swipe"
+};
+static const char* const counter_names[COUNTER_COUNT] = {
+	"frames", "triggers", "drops", "errors", "reconnects", "prefiltered", "unconverted", "workspace_hits",
+	"workspace_listings"
+};
+static const char* const phase_names[PHASE_COUNT] = {
+	"config_ms", "haptics_ms", "input_ms", "aerospace_ms", "first_frame_ms", "first_command_ms"
+};
+
+uint64_t stats_now_ns(void)
+{
+#ifdef __APPLE__
+	/* the clock behind mach_absolute_time, which CGEvent timestamps use */
+	return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static int bucket_index(uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+		return (int)value;
+
+	int msb = 63 - __builtin_clzll(value);
+	int shift = msb - SUB_BUCKET_BITS;
+	int index = (shift + 1) * SUB_BUCKETS + (int)((value >> shift) & (SUB_BUCKETS - 1));
+	return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+/* highest value that lands in a bucket */
+static uint64_t bucket_value(int index)
+{
+	if (index < SUB_BUCKETS)
+		return (uint64_t)index;
+
+	int shift = index / SUB_BUCKETS - 1;
+	uint64_t sub = (uint64_t)(index % SUB_BUCKETS);
+	return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void stats_record(stats_stage stage, uint64_t ns)
+{
+	histogram* h = &histograms[stage];
+	atomic_fetch_add_explicit(&h->buckets[bucket_index(ns)], 1, memory_order_relaxed);
+
+	uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+	while (ns > max && !atomic_compare_exchange_weak_explicit(&h->max, &max, ns, memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+void stats_count(stats_counter counter)
+{
+	atomic_fetch_add_explicit(&counters[counter], 1, memory_order_relaxed);
+}
+
+void stats_add(stats_counter counter, uint64_t n)
+{
+	atomic_fetch_add_explicit(&counters[counter], n, memory_order_relaxed);
+}
+
+void stats_startup_begin(void)
+{
+	uint64_t expected = 0;
+	atomic_compare_exchange_strong(&start_ns, &expected, stats_now_ns());
+}
+
+void stats_phase_done(stats_phase phase)
+{
+	if (atomic_load_explicit(&phases_ns[phase], memory_order_relaxed))
+		return;
+	uint64_t expected = 0;
+	atomic_compare_exchange_strong_explicit(&phases_ns[phase], &expected, stats_now_ns(), memory_order_relaxed,
+		memory_order_relaxed);
+}
+
+static uint64_t percentile(const uint64_t* buckets, uint64_t count, double p)
+{
+	uint64_t rank = (uint64_t)(p * count + 0.5);
+	if (rank == 0)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; ++i) {
+		seen += buckets[i];
+		if (seen >= rank)
+			return bucket_value(i);
+	}
+	return bucket_value(BUCKETS - 1);
+}
+
+char* stats_snapshot_json(void)
+{
+	static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	static const char* const quantile_names[] = { "p50_us", "p90_us", "p99_us", "p999_us" };
+
+	cJSON* root = cJSON_CreateObject();
+	if (!root)
+		return NULL;
+
+	uint64_t started = atomic_load(&start_ns);
+	cJSON_AddNumberToObject(root, "uptime_s", started ? (stats_now_ns() - started) / 1e9 : 0.0);
+
+	cJSON* startup = cJSON_AddObjectToObject(root, "startup");
+	for (int i = 0; i < PHASE_COUNT; ++i) {
+		uint64_t done = atomic_load_explicit(&phases_ns[i], memory_order_relaxed);
+		if (started && done)
+			cJSON_AddNumberToObject(startup, phase_names[i], done > started ? (done - started) / 1e6 : 0.0);
+	}
+
+	cJSON* counts = cJSON_AddObjectToObject(root, "counters");
+	for (int i = 0; i < COUNTER_COUNT; ++i)
+		cJSON_AddNumberToObject(counts, counter_names[i],
+			(double)atomic_load_explicit(&counters[i], memory_order_relaxed));
+
+	cJSON* stages = cJSON_AddObjectToObject(root, "stages");
+	uint64_t buckets[BUCKETS];
+	for (int s = 0; s < STAGE_COUNT; ++s) {
+		histogram* h = &histograms[s];
+		/* a copy that is consistent enough for monitoring; writers never wait */
+		uint64_t count = 0;
+		for (int i = 0; i < BUCKETS; ++i) {
+			buckets[i] = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+			count += buckets[i];
+		}
+
+		uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+		cJSON* stage = cJSON_AddObjectToObject(stages, stage_names[s]);
+		cJSON_AddNumberToObject(stage, "count", (double)count);
+		for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); ++q) {
+			uint64_t value = count ? percentile(buckets, count, quantiles[q]) : 0;
+			/* bucket bounds can overshoot the largest value actually seen */
+			cJSON_AddNumberToObject(stage, quantile_names[q], (value < max ? value : max) / 1e3);
+		}
+		cJSON_AddNumberToObject(stage, "max_us", max / 1e3);
+	}
+
+	char* json = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+	return json;
+}
+
+char* stats_socket_path(void)
+{
+	const char* user = getenv("USER");
+	if (!user)
+		user = "unknown";
+
+	size_t len = snprintf(NULL, 0, "/tmp/aerospace-swipe-%s.stats.sock", user);
+	char* path = malloc(len + 1);
+	if (path)
+		snprintf(path, len + 1, "/tmp/aerospace-swipe-%s.stats.sock", user);
+	return path;
+}
+
+static void* server_thread(void* arg)
+{
+	int fd = (int)(intptr_t)arg;
+
+	for (;;) {
+		int conn = accept(fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fprintf(stderr, "Stats: accept failed: %s\n", strerror(errno));
+			break;
+		}
+
+		char* json = stats_snapshot_json();
+		if (json) {
+			size_t len = strlen(json);
+			size_t written = 0;
+			while (written < len) {
+				ssize_t n = write(conn, json + written, len - written);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				written += n;
+			}
+			cJSON_free(json);
+		}
+		close(conn);
+	}
+
+	close(fd);
+	return NULL;
+}
+
+bool stats_server_start(const char* path)
+{
+	uint64_t expected = 0;
+	atomic_compare_exchange_strong(&start_ns, &expected, stats_now_ns());
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Stats: socket path too long: %s\n", path);
+		return false;
+	}
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Stats: failed to create socket: %s\n", strerror(errno));
+		return false;
+	}
+
+	/* the lock file guarantees a single instance, so a leftover socket is
+	 * stale, or an instance handing over to us is on its way out */
+	unlink(path);
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+		fprintf(stderr, "Stats: failed to listen on %s: %s\n", path, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, server_thread, (void*)(intptr_t)fd) != 0) {
+		fprintf(stderr, "Stats: failed to start server thread.\n");
+		close(fd);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Pipeline stages, each timed into its own fixed-size histogram. */
+typedef enum {
+	STAGE_EVENT_TAP, /* event timestamp -> event tap callback */
+	STAGE_TOUCH_CONVERT, /* NSTouch -> touch conversion for one frame */
+	STAGE_DISPATCH, /* event tap -> gesture callback on the worker queue */
+	STAGE_RECOGNITION, /* gesture callback up to the trigger decision */
+	STAGE_LIST_QUERY, /* list-workspaces round trip */
+	STAGE_SWITCH_COMMAND, /* command round trip */
+	STAGE_HAPTIC, /* haptic post -> actuation done */
+	STAGE_SWIPE, /* event timestamp -> command done, end to end */
+	STAGE_COUNT
+} stats_stage;
+
+typedef enum {
+	COUNTER_FRAMES,
+	COUNTER_TRIGGERS,
+	COUNTER_DROPS,
+	COUNTER_ERRORS,
+	COUNTER_RECONNECTS, /* connection attempts retried while aerospace was not listening */
+	COUNTER_PREFILTERED, /* frames rejected before touch conversion */
+	COUNTER_UNCONVERTED, /* touches those frames did not need converted */
+	COUNTER_WORKSPACE_HITS, /* swipes resolved from a cached workspace listing */
+	COUNTER_WORKSPACE_LISTINGS, /* full workspace listings fetched */
+	COUNTER_COUNT
+} stats_counter;
+
+/* Startup milestones, each timed once from stats_startup_begin, so every
+ * snapshot shows how long the process took to handle its first gesture. */
+typedef enum {
+	PHASE_CONFIG, /* config parsed and published */
+	PHASE_HAPTICS, /* default actuator open, or given up on */
+	PHASE_INPUT, /* event tap or input sources running */
+	PHASE_AEROSPACE, /* connected to aerospace */
+	PHASE_FIRST_FRAME, /* first touch frame recognized */
+	PHASE_FIRST_COMMAND, /* first command run */
+	PHASE_COUNT
+} stats_phase;
+
+/* Monotonic time in nanoseconds, on the same clock as event timestamps. */
+uint64_t stats_now_ns(void);
+
+/* Both are a relaxed atomic increment or two; safe from any thread. */
+void stats_record(stats_stage stage, uint64_t ns);
+void stats_count(stats_counter counter);
+void stats_add(stats_counter counter, uint64_t n);
+
+/* Where startup phases are timed from; call first thing in main. */
+void stats_startup_begin(void);
+
+/* Only the first call per phase counts, later ones are a relaxed load. */
+void stats_phase_done(stats_phase phase);
+
+/* Percentiles and counters as a JSON document; the caller frees it. */
+char* stats_snapshot_json(void);
+
+/* /tmp/aerospace-swipe-$USER.stats.sock; the caller frees it. */
+char* stats_socket_path(void);
+
+/* Serve a snapshot to every client that connects to path. */
+bool stats_server_start(const char* path);
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+/* One finger in one frame, as the recognizer sees it. */
+typedef struct {
+	uint64_t id; /* identity hash, stable for the life of the finger */
+	double x; /* normalized, 0 at the left edge */
+	double y; /* normalized, 0 at the bottom edge */
+	int phase; /* NSTouchPhase bits */
+	double timestamp; /* seconds */
+	double velocity; /* x, normalized units per second */
+} touch;
+
+/* the NSTouchPhase values that end a touch */
+#define TOUCH_PHASE_ENDED 8
+#define TOUCH_PHASE_CANCELLED 16
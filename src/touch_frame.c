@@ -0,0 +1,43 @@
+#include "touch_frame.h"
+#include <string.h>
+
+void touch_frame_init(touch_frame* frame, uint64_t device, double timestamp)
+{
+	memset(frame, 0, sizeof(*frame));
+	frame->device = device;
+	frame->timestamp = timestamp;
+}
+
+void touch_frame_add(touch_frame* frame, const touch* contact)
+{
+	int i = frame->count++;
+	if (i == 0)
+		frame->timestamp = contact->timestamp;
+	if (i >= FRAME_CONTACTS)
+		return;
+	frame->id[i] = contact->id;
+	frame->x[i] = (float)contact->x;
+	frame->y[i] = (float)contact->y;
+	frame->velocity[i] = (float)contact->velocity;
+	frame->phase[i] = (uint8_t)contact->phase;
+}
+
+void touch_frame_from_touches(touch_frame* frame, uint64_t device, const touch* touches, int count)
+{
+	touch_frame_init(frame, device, count > 0 ? touches[0].timestamp : 0.0);
+	for (int i = 0; i < count; ++i)
+		touch_frame_add(frame, &touches[i]);
+}
+
+touch touch_frame_get(const touch_frame* frame, int i)
+{
+	touch result = {
+		.id = frame->id[i],
+		.x = frame->x[i],
+		.y = frame->y[i],
+		.phase = frame->phase[i],
+		.timestamp = frame->timestamp,
+		.velocity = frame->velocity[i],
+	};
+	return result;
+}
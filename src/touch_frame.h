@@ -0,0 +1,125 @@
+#pragma once
+#include "touch.h"
+#include <stdint.h>
+
+/* One frame of contacts as the recognizer consumes it: float32 arrays, one
+ * per field, in a fixed-capacity block of three cache lines. The first two
+ * hold everything the finger-count gate and the means read, the third the
+ * ids only the contact tracking needs. Less than half the size of the same
+ * contacts as touch structs, and the per-frame reductions become a few
+ * vector adds.
+ *
+ * A frame counts all of its contacts but stores the first FRAME_CONTACTS,
+ * which is more than any bound finger count. Lanes past the stored ones are
+ * kept zero so reductions can run over all of them. The y velocity is not
+ * kept; nothing downstream of conversion uses it. */
+
+#define FRAME_CONTACTS 8 /* touch_frame_sum assumes two vectors of four */
+
+typedef struct {
+	float x[FRAME_CONTACTS]; /* normalized, 0 at the left edge */
+	float y[FRAME_CONTACTS]; /* normalized, 0 at the bottom edge */
+	float velocity[FRAME_CONTACTS]; /* x, normalized units per second */
+	double timestamp; /* seconds, of the first contact */
+	uint64_t device;
+	int count; /* contacts in the frame, stored or not */
+	uint8_t phase[FRAME_CONTACTS]; /* NSTouchPhase bits */
+	uint64_t id[FRAME_CONTACTS] __attribute__((aligned(64))); /* identity hashes */
+} __attribute__((aligned(64))) touch_frame;
+
+/* Means over the stored contacts. */
+typedef struct {
+	float x;
+	float y;
+	float velocity;
+} frame_means;
+
+/* An empty frame: count 0 and every lane zero. */
+void touch_frame_init(touch_frame* frame, uint64_t device, double timestamp);
+
+/* Append a contact; past FRAME_CONTACTS it is only counted. */
+void touch_frame_add(touch_frame* frame, const touch* contact);
+
+void touch_frame_from_touches(touch_frame* frame, uint64_t device, const touch* touches, int count);
+
+/* Contacts actually stored. */
+static inline int touch_frame_stored(const touch_frame* frame)
+{
+	return frame->count < FRAME_CONTACTS ? frame->count : FRAME_CONTACTS;
+}
+
+/* The stored contact i as a touch, e.g. for writing a trace. */
+touch touch_frame_get(const touch_frame* frame, int i);
+
+/* Sum of one field's lanes, with GCC/clang vector extensions where
+ * available (SSE or NEON without intrinsics): two 4-lane adds, then a fixed
+ * pairwise horizontal sum. The fallback does the same additions in the same
+ * order, so every path summing the same lanes gets the same bits. */
+#if defined(__GNUC__)
+typedef float frame_lanes4 __attribute__((vector_size(16)));
+
+static inline float touch_frame_sum(const float* lanes)
+{
+	frame_lanes4 lo, hi;
+	__builtin_memcpy(&lo, lanes, sizeof(lo));
+	__builtin_memcpy(&hi, lanes + 4, sizeof(hi));
+	frame_lanes4 s = lo + hi;
+	return (s[0] + s[2]) + (s[1] + s[3]);
+}
+
+/* touch_frame_sum split in two, to reduce four frames' lanes at once where
+ * the compiler can shuffle vectors (clang, GCC 12 on). The fold is its two
+ * 4-lane adds, of the lanes less base lane by lane when base is not NULL;
+ * sum4 finishes four folds with the same pairwise sums, three vector adds
+ * between shuffles. */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_shufflevector)
+#define TOUCH_FRAME_SUM4 1
+
+static inline frame_lanes4 touch_frame_fold(const float* lanes, const float* base)
+{
+	frame_lanes4 lo, hi;
+	__builtin_memcpy(&lo, lanes, sizeof(lo));
+	__builtin_memcpy(&hi, lanes + 4, sizeof(hi));
+	if (base) {
+		frame_lanes4 base_lo, base_hi;
+		__builtin_memcpy(&base_lo, base, sizeof(base_lo));
+		__builtin_memcpy(&base_hi, base + 4, sizeof(base_hi));
+		lo -= base_lo;
+		hi -= base_hi;
+	}
+	return lo + hi;
+}
+
+static inline frame_lanes4 touch_frame_sum4(frame_lanes4 a, frame_lanes4 b, frame_lanes4 c, frame_lanes4 d)
+{
+	/* a0+a2 b0+b2 a1+a3 b1+b3, and the same of c and d */
+	frame_lanes4 ab = __builtin_shufflevector(a, b, 0, 4, 1, 5) + __builtin_shufflevector(a, b, 2, 6, 3, 7);
+	frame_lanes4 cd = __builtin_shufflevector(c, d, 0, 4, 1, 5) + __builtin_shufflevector(c, d, 2, 6, 3, 7);
+	return __builtin_shufflevector(ab, cd, 0, 1, 4, 5) + __builtin_shufflevector(ab, cd, 2, 3, 6, 7);
+}
+#endif
+#endif
+#else
+static inline float touch_frame_sum(const float* lanes)
+{
+	float s[4];
+	for (int i = 0; i < 4; ++i)
+		s[i] = lanes[i] + lanes[i + 4];
+	return (s[0] + s[2]) + (s[1] + s[3]);
+}
+#endif
+
+/* Centroid and mean x velocity; all zero for an empty frame. Inline, it is
+ * a handful of instructions on the recognizer's hot path. */
+static inline frame_means touch_frame_means(const touch_frame* frame)
+{
+	frame_means means = { 0.0f, 0.0f, 0.0f };
+	int n = touch_frame_stored(frame);
+	if (n == 0)
+		return means;
+	means.x = touch_frame_sum(frame->x) / n;
+	means.y = touch_frame_sum(frame->y) / n;
+	means.velocity = touch_frame_sum(frame->velocity) / n;
+	return means;
+}
@@ -0,0 +1,134 @@
+#include "touch_trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* indexed by swipe_direction */
+static const char* const direction_names[] = { "left", "right", "up", "down" };
+#define DIRECTIONS (int)(sizeof(direction_names) / sizeof(direction_names[0]))
+
+const char* touch_trace_label_name(int label)
+{
+	if (label == TRACE_NONE)
+		return "none";
+	if (label >= 0 && label < DIRECTIONS)
+		return direction_names[label];
+	return "-";
+}
+
+bool touch_trace_parse_label(const char* name, int* label)
+{
+	if (strcmp(name, "none") == 0) {
+		*label = TRACE_NONE;
+		return true;
+	}
+	if (strcmp(name, "-") == 0) {
+		*label = TRACE_UNLABELLED;
+		return true;
+	}
+	for (int i = 0; i < DIRECTIONS; ++i) {
+		if (strcmp(name, direction_names[i]) == 0) {
+			*label = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void touch_trace_reader_init(trace_reader* reader, FILE* file, const char* name)
+{
+	reader->file = file;
+	reader->name = name;
+	reader->line = 0;
+	reader->gesture = -1;
+	reader->label = TRACE_UNLABELLED;
+}
+
+static bool parse_frame(char* cursor, trace_frame* frame)
+{
+	char* end;
+	double t = strtod(cursor, &end);
+	if (end == cursor)
+		return false;
+	cursor = end;
+
+	long count = strtol(cursor, &end, 10);
+	if (end == cursor || count < 0 || count > TRACE_MAX_CONTACTS)
+		return false;
+	cursor = end;
+
+	for (long i = 0; i < count; ++i) {
+		touch* contact = &frame->touches[i];
+		memset(contact, 0, sizeof(*contact));
+		contact->timestamp = t;
+
+		contact->id = strtoull(cursor, &end, 10);
+		if (end == cursor)
+			return false;
+		cursor = end;
+		contact->x = strtod(cursor, &end);
+		if (end == cursor)
+			return false;
+		cursor = end;
+		contact->y = strtod(cursor, &end);
+		if (end == cursor)
+			return false;
+		cursor = end;
+		contact->phase = (int)strtol(cursor, &end, 10);
+		if (end == cursor)
+			return false;
+		cursor = end;
+	}
+
+	frame->count = (int)count;
+	return true;
+}
+
+bool touch_trace_next(trace_reader* reader, trace_frame* frame)
+{
+	char line[2048];
+	while (fgets(line, sizeof(line), reader->file)) {
+		reader->line++;
+		char* cursor = line;
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
+
+		if (cursor[0] == 'g' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+			char name[16];
+			int label;
+			if (sscanf(cursor + 2, "%15s", name) != 1 || !touch_trace_parse_label(name, &label)) {
+				fprintf(stderr, "%s:%d: unknown gesture label\n", reader->name, reader->line);
+				label = TRACE_UNLABELLED;
+			}
+			reader->gesture++;
+			reader->label = label;
+		} else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+			if (!parse_frame(cursor + 2, frame)) {
+				fprintf(stderr, "%s:%d: malformed frame\n", reader->name, reader->line);
+				continue;
+			}
+			/* frames before any g line form an unlabelled gesture */
+			if (reader->gesture < 0)
+				reader->gesture = 0;
+			frame->gesture = reader->gesture;
+			frame->label = reader->label;
+			return true;
+		} else if (cursor[0] != '#' && cursor[0] != '\n' && cursor[0] != '\0') {
+			fprintf(stderr, "%s:%d: unknown line\n", reader->name, reader->line);
+		}
+	}
+	return false;
+}
+
+void touch_trace_write_label(FILE* file, int label)
+{
+	fprintf(file, "g %s\n", touch_trace_label_name(label));
+}
+
+void touch_trace_write_frame(FILE* file, const touch* touches, int count)
+{
+	fprintf(file, "f %.6f %d", count > 0 ? touches[0].timestamp : 0.0, count);
+	for (int i = 0; i < count; ++i)
+		fprintf(file, " %llu %.5f %.5f %d", (unsigned long long)touches[i].id, touches[i].x,
+			touches[i].y, touches[i].phase);
+	fputc('\n', file);
+}
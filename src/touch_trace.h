@@ -0,0 +1,48 @@
+#pragma once
+#include "touch.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Recorded touch frames, one per line, for replaying the recognizer offline:
+ *
+ *   # comment
+ *   g right              start of a gesture, labelled left/right/up/down,
+ *                        none (must not trigger) or - (unlabelled)
+ *   f <t> <n> <id> <x> <y> <phase> ...
+ *
+ * Timestamps are seconds, positions normalized as in touch. */
+
+#define TRACE_MAX_CONTACTS 16
+
+enum {
+	TRACE_UNLABELLED = -2,
+	TRACE_NONE = -1
+	/* otherwise a swipe_direction */
+};
+
+typedef struct {
+	FILE* file;
+	const char* name;
+	int line;
+	int gesture; /* index of the current g line, -1 before the first */
+	int label;
+} trace_reader;
+
+typedef struct {
+	int gesture;
+	int label;
+	int count;
+	touch touches[TRACE_MAX_CONTACTS]; /* velocities are left at 0 */
+} trace_frame;
+
+void touch_trace_reader_init(trace_reader* reader, FILE* file, const char* name);
+
+/* Next frame, or false at the end of the file. A malformed line is reported
+ * on stderr and skipped. */
+bool touch_trace_next(trace_reader* reader, trace_frame* frame);
+
+void touch_trace_write_label(FILE* file, int label);
+void touch_trace_write_frame(FILE* file, const touch* touches, int count);
+
+const char* touch_trace_label_name(int label);
+bool touch_trace_parse_label(const char* name, int* label);
@@ -0,0 +1,182 @@
+#include "trace.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* must be a power of two; at 40 bytes a span this is 2.5MB, several seconds
+ * of continuous swiping between two writer passes */
+#define TRACE_EVENTS 65536
+#define WRITE_INTERVAL_NS 250000000L
+
+typedef struct {
+	_Atomic uint64_t sequence; /* position + 1 once the span is complete */
+	const char* name;
+	uint64_t start_ns;
+	uint64_t duration_ns;
+	uint64_t tid;
+} trace_slot;
+
+_Atomic bool trace_active = false;
+static trace_slot* ring = NULL;
+static _Atomic uint64_t head = 0;
+static uint64_t cursor = 0; /* next position to write, owned by write_mutex */
+static uint64_t dropped = 0;
+static uint64_t origin_ns = 0;
+static FILE* file = NULL;
+static bool first_event = true;
+static int pid = 0;
+static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local uint64_t cached_tid = 0;
+
+static uint64_t thread_id(void)
+{
+	if (cached_tid == 0) {
+#ifdef __APPLE__
+		pthread_threadid_np(NULL, &cached_tid);
+#else
+		/* only needs to be unique per thread for the viewer */
+		cached_tid = (uint64_t)pthread_self();
+#endif
+	}
+	return cached_tid;
+}
+
+void trace_end(const char* name, uint64_t start_ns)
+{
+	if (start_ns == 0)
+		return;
+
+	uint64_t end_ns = stats_now_ns();
+	uint64_t position = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed);
+	trace_slot* slot = &ring[position & (TRACE_EVENTS - 1)];
+
+	atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot->name = name;
+	slot->start_ns = start_ns;
+	slot->duration_ns = end_ns - start_ns;
+	slot->tid = thread_id();
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+static void write_event(const char* name, uint64_t start_ns, uint64_t duration_ns, uint64_t tid)
+{
+	/* ts and dur are microseconds; keep sub-microsecond precision */
+	double ts = start_ns > origin_ns ? (start_ns - origin_ns) / 1e3 : 0.0;
+	fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"swipe\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%llu}",
+		first_event ? "" : ",\n", name, ts, duration_ns / 1e3, pid, (unsigned long long)tid);
+	first_event = false;
+}
+
+/* Copy out every completed span. A span claimed but not yet complete stops
+ * the pass; it is picked up next time. Spans overwritten before the writer
+ * got to them are counted and skipped. */
+static void write_pending(void)
+{
+	uint64_t end = atomic_load_explicit(&head, memory_order_acquire);
+	if (end - cursor > TRACE_EVENTS) {
+		dropped += end - cursor - TRACE_EVENTS;
+		cursor = end - TRACE_EVENTS;
+	}
+
+	while (cursor < end) {
+		trace_slot* slot = &ring[cursor & (TRACE_EVENTS - 1)];
+		uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence < cursor + 1)
+			break;
+		if (sequence > cursor + 1) {
+			/* lapped while we were writing */
+			++dropped;
+			++cursor;
+			continue;
+		}
+
+		const char* name = slot->name;
+		uint64_t start_ns = slot->start_ns;
+		uint64_t duration_ns = slot->duration_ns;
+		uint64_t tid = slot->tid;
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != sequence)
+			continue;
+
+		write_event(name, start_ns, duration_ns, tid);
+		++cursor;
+	}
+	fflush(file);
+}
+
+static void* writer_thread(void* arg)
+{
+	(void)arg;
+	for (;;) {
+		struct timespec ts = { 0, WRITE_INTERVAL_NS };
+		nanosleep(&ts, NULL);
+
+		pthread_mutex_lock(&write_mutex);
+		if (!file) {
+			pthread_mutex_unlock(&write_mutex);
+			break;
+		}
+		write_pending();
+		pthread_mutex_unlock(&write_mutex);
+	}
+	return NULL;
+}
+
+bool trace_start(void)
+{
+	const char* path = getenv("AEROSPACE_SWIPE_TRACE");
+	if (!path || !*path)
+		return true;
+
+	ring = calloc(TRACE_EVENTS, sizeof(trace_slot));
+	file = ring ? fopen(path, "w") : NULL;
+	if (!file) {
+		fprintf(stderr, "Trace: cannot write %s: %s\n", path, strerror(errno));
+		free(ring);
+		ring = NULL;
+		return false;
+	}
+
+	pid = (int)getpid();
+	origin_ns = stats_now_ns();
+	fprintf(file, "[\n");
+	write_event("trace_start", origin_ns, 0, thread_id());
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, writer_thread, NULL) != 0) {
+		fprintf(stderr, "Trace: failed to start writer thread.\n");
+		fclose(file);
+		file = NULL;
+		free(ring);
+		ring = NULL;
+		return false;
+	}
+	pthread_detach(thread);
+
+	atexit(trace_stop);
+	atomic_store(&trace_active, true);
+	fprintf(stderr, "Trace: writing spans to %s\n", path);
+	return true;
+}
+
+void trace_stop(void)
+{
+	atomic_store(&trace_active, false);
+
+	pthread_mutex_lock(&write_mutex);
+	if (file) {
+		write_pending();
+		if (dropped)
+			fprintf(stderr, "Trace: %llu spans dropped, the writer fell behind.\n",
+				(unsigned long long)dropped);
+		fprintf(file, "\n]\n");
+		fclose(file);
+		file = NULL;
+	}
+	pthread_mutex_unlock(&write_mutex);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "stats.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Opt-in Chrome trace-event export (open the file in Perfetto or
+ * chrome://tracing). Spans are appended to an in-memory ring and a background
+ * thread writes them out, so tracing adds two clock reads and an atomic add to
+ * each span. Disabled, a span costs one relaxed load. */
+
+extern _Atomic bool trace_active;
+
+/* Start of a span, or 0 when tracing is off. */
+static inline uint64_t trace_begin(void)
+{
+	return atomic_load_explicit(&trace_active, memory_order_relaxed) ? stats_now_ns() : 0;
+}
+
+/* Close a span opened by trace_begin. name must be a string literal. */
+void trace_end(const char* name, uint64_t start_ns);
+
+/* Trace to $AEROSPACE_SWIPE_TRACE when it is set; a no-op otherwise. */
+bool trace_start(void);
+
+/* Write out what is buffered and terminate the JSON array. */
+void trace_stop(void);
@@ -0,0 +1,63 @@
+#include "velocity.h"
+#include <string.h>
+
+void velocity_reset(velocity_window* window)
+{
+	memset(window, 0, sizeof(*window));
+}
+
+void velocity_add(velocity_window* window, double t, double x)
+{
+	if (window->count > 0) {
+		int last = (window->next + VELOCITY_SAMPLES - 1) % VELOCITY_SAMPLES;
+		/* several touches of one frame can share a timestamp, and a
+		 * sample going backwards in time is no use to a slope */
+		if (t <= window->t[last]) {
+			window->x[last] = x;
+			return;
+		}
+	}
+
+	window->t[window->next] = t;
+	window->x[window->next] = x;
+	window->next = (window->next + 1) % VELOCITY_SAMPLES;
+	if (window->count < VELOCITY_SAMPLES)
+		window->count++;
+}
+
+bool velocity_estimate(const velocity_window* window, double* vx)
+{
+	*vx = 0.0;
+
+	int last = (window->next + VELOCITY_SAMPLES - 1) % VELOCITY_SAMPLES;
+	double newest = window->t[last];
+
+	/* time is taken relative to the newest sample to keep the sums small */
+	double st = 0.0, sx = 0.0;
+	int n = 0;
+	for (int i = 0; i < window->count; ++i) {
+		int k = (last + VELOCITY_SAMPLES - i) % VELOCITY_SAMPLES;
+		double t = window->t[k] - newest;
+		if (-t > VELOCITY_MAX_AGE)
+			break;
+		st += t;
+		sx += window->x[k];
+		n++;
+	}
+	if (n < VELOCITY_MIN_SAMPLES)
+		return false;
+
+	double mt = st / n, mx = sx / n;
+	double stt = 0.0, stx = 0.0;
+	for (int i = 0; i < n; ++i) {
+		int k = (last + VELOCITY_SAMPLES - i) % VELOCITY_SAMPLES;
+		double dt = window->t[k] - newest - mt;
+		stt += dt * dt;
+		stx += dt * (window->x[k] - mx);
+	}
+	if (stt <= 0.0)
+		return false;
+
+	*vx = stx / stt;
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdbool.h>
+
+/* Per-contact velocity by least squares over the last few samples. A raw
+ * finite difference between two events divides by a dt of a few ms, so a
+ * millisecond of timestamp jitter swings it by 10-20%; the regression slope
+ * over a window averages that out while lagging the true velocity by only
+ * about half the window. */
+
+#define VELOCITY_SAMPLES 5
+#define VELOCITY_MIN_SAMPLES 3
+#define VELOCITY_MAX_AGE 0.06 /* seconds; older samples describe another motion */
+
+typedef struct {
+	double t[VELOCITY_SAMPLES];
+	double x[VELOCITY_SAMPLES];
+	int count;
+	int next;
+} velocity_window;
+
+void velocity_reset(velocity_window* window);
+
+void velocity_add(velocity_window* window, double t, double x);
+
+/* Slope of x over time in units per second; only the horizontal velocity
+ * feeds the recognizer. Returns false, with the velocity 0, until the window
+ * holds VELOCITY_MIN_SAMPLES recent samples. */
+bool velocity_estimate(const velocity_window* window, double* vx);
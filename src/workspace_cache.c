@@ -0,0 +1,75 @@
+#include "workspace_cache.h"
+
+void workspace_cache_init(workspace_cache* cache)
+{
+	for (int i = 0; i < WORKSPACE_CACHE_MONITORS; ++i) {
+		cache->entries[i].monitor = -1;
+		cache->entries[i].non_empty = false;
+		cache->entries[i].listed_ns = 0;
+		workspace_table_init(&cache->entries[i].table);
+	}
+	cache->focused_monitor = -1;
+	workspace_table_init(&cache->focus);
+}
+
+void workspace_cache_free(workspace_cache* cache)
+{
+	for (int i = 0; i < WORKSPACE_CACHE_MONITORS; ++i)
+		workspace_table_free(&cache->entries[i].table);
+	workspace_table_free(&cache->focus);
+	workspace_cache_init(cache);
+}
+
+workspace_cache_entry* workspace_cache_entry_for(workspace_cache* cache, int monitor)
+{
+	workspace_cache_entry* oldest = &cache->entries[0];
+	for (int i = 0; i < WORKSPACE_CACHE_MONITORS; ++i) {
+		workspace_cache_entry* entry = &cache->entries[i];
+		if (entry->monitor == monitor)
+			return entry;
+		if (entry->monitor < 0 || (oldest->monitor >= 0 && entry->listed_ns < oldest->listed_ns))
+			oldest = entry;
+	}
+	oldest->monitor = monitor;
+	oldest->listed_ns = 0;
+	return oldest;
+}
+
+workspace_cache_entry* workspace_cache_listed(workspace_cache* cache, workspace_cache_entry* entry,
+	bool non_empty, uint64_t now_ns)
+{
+	int monitor = entry->table.monitor;
+	if (monitor >= 0 && monitor != entry->monitor) {
+		workspace_cache_entry* owner = workspace_cache_entry_for(cache, monitor);
+		if (owner != entry) {
+			/* swap rather than copy: both tables keep their memory, and
+			 * the one left behind is no longer trusted */
+			workspace_table listed = owner->table;
+			owner->table = entry->table;
+			entry->table = listed;
+			entry->listed_ns = 0;
+			entry = owner;
+		}
+	}
+	entry->non_empty = non_empty;
+	entry->listed_ns = now_ns;
+	return entry;
+}
+
+bool workspace_cache_use(workspace_cache_entry* entry, bool non_empty, const char* name, uint64_t now_ns)
+{
+	if (entry->listed_ns == 0 || entry->non_empty != non_empty || now_ns - entry->listed_ns > WORKSPACE_CACHE_MAX_AGE_NS)
+		return false;
+	int index = workspace_table_find(&entry->table, name);
+	if (index < 0)
+		return false;
+	entry->table.focused = index;
+	return true;
+}
+
+void workspace_cache_forget(workspace_cache* cache)
+{
+	for (int i = 0; i < WORKSPACE_CACHE_MONITORS; ++i)
+		cache->entries[i].listed_ns = 0;
+	cache->focused_monitor = -1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "workspace_table.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The workspace listing of every monitor seen lately, keyed by aerospace's
+ * monitor id, and which monitor has the focus. A swipe only has to learn
+ * where the focus is, a one line reply, and resolves its target from the
+ * focused monitor's cached listing. A listing is fetched again when the
+ * focused workspace is missing from it (a workspace was added, renamed or
+ * moved here), when it is older than WORKSPACE_CACHE_MAX_AGE_NS, or after
+ * workspace_cache_forget: whenever the executor sends a command that may
+ * change the workspaces, when a switch to a listed one fails, and on a
+ * display reconfiguration.
+ *
+ * Not thread-safe; the executor guards it with its client lock. */
+
+#define WORKSPACE_CACHE_MONITORS 8 /* least recently listed ones give way */
+/* Changes made outside the daemon, at the keyboard or from a script, that
+ * the focus alone does not reveal: a workspace moved off a monitor or
+ * created on it unfocused. A listing is trusted for one burst of swipes,
+ * not across the pauses in which such changes are made. */
+#define WORKSPACE_CACHE_MAX_AGE_NS (1000000000ull)
+
+typedef struct {
+	int monitor; /* -1 for an unused entry */
+	bool non_empty; /* listed with --empty no */
+	uint64_t listed_ns; /* stats_now_ns of the listing, 0 once forgotten */
+	workspace_table table;
+} workspace_cache_entry;
+
+typedef struct {
+	workspace_cache_entry entries[WORKSPACE_CACHE_MONITORS];
+	int focused_monitor; /* -1 until known */
+	workspace_table focus; /* the last focus query's one line */
+} workspace_cache;
+
+void workspace_cache_init(workspace_cache* cache);
+void workspace_cache_free(workspace_cache* cache);
+
+/* The entry for monitor. One that has none takes over the least recently
+ * listed entry, keeping its table's memory but marked as never listed.
+ * Never NULL. */
+workspace_cache_entry* workspace_cache_entry_for(workspace_cache* cache, int monitor);
+
+/* A listing just parsed into entry's table belongs to the table's own
+ * monitor, which may not be the one entry was for. Returns the entry it now
+ * sits in, marked listed at now_ns. */
+workspace_cache_entry* workspace_cache_listed(workspace_cache* cache, workspace_cache_entry* entry,
+	bool non_empty, uint64_t now_ns);
+
+/* Whether entry's listing can resolve a swipe at now_ns, focused on name.
+ * If so its table's focus is moved there. */
+bool workspace_cache_use(workspace_cache_entry* entry, bool non_empty, const char* name, uint64_t now_ns);
+
+/* Every listing is fetched again on its next use. */
+void workspace_cache_forget(workspace_cache* cache);
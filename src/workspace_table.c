@@ -0,0 +1,221 @@
+#include "workspace_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_SLOTS 16
+
+/* FNV-1a over the name's bytes */
+static uint32_t name_hash(const char* name, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void workspace_table_init(workspace_table* table)
+{
+	memset(table, 0, sizeof(*table));
+	table->focused = -1;
+	table->monitor = -1;
+}
+
+void workspace_table_free(workspace_table* table)
+{
+	free(table->names);
+	free(table->order);
+	free(table->slots);
+	workspace_table_init(table);
+}
+
+/* After a failed allocation: empty, with no index left pointing at names
+ * that are gone. The next parse allocates the slots afresh. */
+static void clear(workspace_table* table)
+{
+	free(table->slots);
+	table->slots = NULL;
+	table->slot_mask = 0;
+	table->names_len = 0;
+	table->count = 0;
+	table->focused = -1;
+	table->monitor = -1;
+}
+
+/* Drop every name from index on. */
+static void drop_from(workspace_table* table, int index)
+{
+	if (index < table->count) {
+		table->names_len = table->order[index];
+		table->count = index;
+	}
+}
+
+static bool append_name(workspace_table* table, const char* name, size_t len)
+{
+	if (table->names_len + len + 1 > table->names_cap) {
+		size_t cap = table->names_cap ? table->names_cap : 256;
+		while (cap < table->names_len + len + 1)
+			cap *= 2;
+		char* grown = realloc(table->names, cap);
+		if (!grown)
+			return false;
+		table->names = grown;
+		table->names_cap = cap;
+	}
+	if (table->count == table->order_cap) {
+		int cap = table->order_cap ? table->order_cap * 2 : 32;
+		uint32_t* grown = realloc(table->order, sizeof(uint32_t) * cap);
+		if (!grown)
+			return false;
+		table->order = grown;
+		table->order_cap = cap;
+	}
+
+	table->order[table->count++] = (uint32_t)table->names_len;
+	memcpy(table->names + table->names_len, name, len);
+	table->names[table->names_len + len] = '\0';
+	table->names_len += len + 1;
+	return true;
+}
+
+/* Index every name, keeping the load factor at or under a half. A name
+ * listed twice keeps its first index. */
+static bool rehash(workspace_table* table)
+{
+	uint32_t slots = MIN_SLOTS;
+	while (slots < (uint32_t)table->count * 2)
+		slots *= 2;
+	if (slots != table->slot_mask + 1 || !table->slots) {
+		int32_t* grown = realloc(table->slots, sizeof(int32_t) * slots);
+		if (!grown)
+			return false;
+		table->slots = grown;
+		table->slot_mask = slots - 1;
+	}
+	memset(table->slots, 0xff, sizeof(int32_t) * slots);
+
+	for (int i = 0; i < table->count; ++i) {
+		const char* name = workspace_table_name(table, i);
+		uint32_t slot = name_hash(name, strlen(name)) & table->slot_mask;
+		for (;; slot = (slot + 1) & table->slot_mask) {
+			int32_t at = table->slots[slot];
+			if (at < 0) {
+				table->slots[slot] = i;
+				break;
+			}
+			if (strcmp(workspace_table_name(table, at), name) == 0)
+				break;
+		}
+	}
+	return true;
+}
+
+bool workspace_table_parse(workspace_table* table, const char* reply, size_t len)
+{
+	/* names are compared against the previous reply's until one differs;
+	 * from there on the rest is appended afresh */
+	bool changed = false;
+	int focused = -1;
+	int monitor = -1;
+	int index = 0;
+
+	for (const char* line = reply; line < reply + len;) {
+		const char* end = memchr(line, '\n', reply + len - line);
+		if (!end)
+			end = reply + len;
+		const char* tab = memchr(line, '\t', end - line);
+		const char* name_end = tab ? tab : end;
+		size_t name_len = name_end - line;
+		if (name_len > 0 && name_end[-1] == '\r')
+			name_len--;
+
+		if (name_len > 0) {
+			if (!changed) {
+				const char* known = index < table->count ? workspace_table_name(table, index) : NULL;
+				if (!known || strlen(known) != name_len || memcmp(known, line, name_len) != 0) {
+					changed = true;
+					drop_from(table, index);
+				}
+			}
+			if (changed) {
+				if (!append_name(table, line, name_len)) {
+					clear(table);
+					return false;
+				}
+			}
+			if (tab && end - tab >= 5 && memcmp(tab + 1, "true", 4) == 0)
+				focused = index;
+			const char* column = tab ? memchr(tab + 1, '\t', end - tab - 1) : NULL;
+			if (column && monitor < 0) {
+				monitor = 0;
+				for (const char* digit = column + 1; digit < end && *digit >= '0' && *digit <= '9'; ++digit)
+					monitor = monitor * 10 + (*digit - '0');
+			}
+			index++;
+		}
+		line = end + 1;
+	}
+
+	/* a shorter reply with the same leading names is a change too */
+	if (!changed && index < table->count) {
+		drop_from(table, index);
+		changed = true;
+	}
+	if ((changed || !table->slots) && !rehash(table)) {
+		clear(table);
+		return false;
+	}
+	if (changed)
+		table->rebuilds++;
+	table->focused = focused;
+	table->monitor = monitor;
+	return true;
+}
+
+int workspace_table_find(const workspace_table* table, const char* name)
+{
+	if (!table->slots)
+		return -1;
+	uint32_t slot = name_hash(name, strlen(name)) & table->slot_mask;
+	for (;; slot = (slot + 1) & table->slot_mask) {
+		int32_t at = table->slots[slot];
+		if (at < 0)
+			return -1;
+		if (strcmp(workspace_table_name(table, at), name) == 0)
+			return at;
+	}
+}
+
+int workspace_table_step(const workspace_table* table, int offset, bool wrap)
+{
+	int count = table->count;
+	int from = table->focused;
+	if (from < 0 || count == 0)
+		return -1;
+
+	int to;
+	if (wrap) {
+		to = (from + offset % count + count) % count;
+	} else {
+		long target = (long)from + offset;
+		to = target < 0 ? 0 : target >= count ? count - 1 : (int)target;
+	}
+	return to == from ? -1 : to;
+}
+
+char* workspace_table_listing(const workspace_table* table)
+{
+	char* listing = malloc(table->names_len + 1);
+	if (!listing)
+		return NULL;
+	/* the arena already is the names in order, NUL for newline */
+	if (table->names_len)
+		memcpy(listing, table->names, table->names_len);
+	for (size_t i = 0; i < table->names_len; ++i)
+		if (listing[i] == '\0')
+			listing[i] = '\n';
+	listing[table->names_len] = '\0';
+	return listing;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A monitor's workspaces as aerospace orders them, parsed from a
+ * list-workspaces reply with one "name\tfocused\tmonitor" line per
+ * workspace (see WORKSPACE_TABLE_FORMAT). Names are interned once in an
+ * arena and indexed by an open addressing hash, so a lookup or a step from
+ * the focused workspace is O(1) however many workspaces there are.
+ *
+ * A reply listing the same names in the same order as the previous one
+ * only moves the focus: nothing is reallocated or rehashed, which is the
+ * common case of swiping back and forth. */
+
+/* the --format argument that produces the lines parsed here */
+#define WORKSPACE_TABLE_FORMAT "%{workspace}%{tab}%{workspace-is-focused}%{tab}%{monitor-id}"
+
+typedef struct {
+	char* names; /* interned names, each NUL-terminated */
+	size_t names_len;
+	size_t names_cap;
+	uint32_t* order; /* offsets into names, in aerospace's order */
+	int count;
+	int order_cap;
+	int32_t* slots; /* indices into order, -1 for an empty slot */
+	uint32_t slot_mask; /* slot count - 1, a power of two */
+	int focused; /* index into order, -1 when the focused one is not listed */
+	int monitor; /* the first line's monitor id, -1 when it has none */
+	uint64_t rebuilds; /* replies whose names differed from the previous one */
+} workspace_table;
+
+void workspace_table_init(workspace_table* table);
+void workspace_table_free(workspace_table* table);
+
+/* Replace the contents with a list-workspaces reply. The columns after
+ * the name are optional; a line with none is a workspace that is not
+ * focused. False when out of memory, in which case the table is empty. */
+bool workspace_table_parse(workspace_table* table, const char* reply, size_t len);
+
+/* Index of name, -1 when it is not listed. */
+int workspace_table_find(const workspace_table* table, const char* name);
+
+static inline const char* workspace_table_name(const workspace_table* table, int index)
+{
+	return table->names + table->order[index];
+}
+
+/* The workspace offset places from the focused one, negative for prev.
+ * With wrap the order is a ring; without, the step stops at either end. -1
+ * when nothing is focused or the step does not move. */
+int workspace_table_step(const workspace_table* table, int offset, bool wrap);
+
+/* The names one per line, as aerospace's --stdin takes them. The caller
+ * frees it; NULL when out of memory. */
+char* workspace_table_listing(const workspace_table* table);
@@ -0,0 +1,379 @@
+#include "../src/cJSON.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Stands in for aerospace's server socket and prints one line per request
+ * with the connection it came on. It keeps a list of workspaces, 1 to 5 or
+ * -w count of them, spread in order over -m count monitors (one by
+ * default), the workspace each monitor shows and which monitor is focused:
+ *
+ *   list-workspaces [--monitor focused|all|id] [--focused] [--format f]
+ *                                 the workspaces, one per line, with
+ *                                 %{workspace}, %{workspace-is-focused},
+ *                                 %{monitor-id}, %{tab} and %{newline}
+ *                                 expanded in f
+ *   workspace name                show name and focus its monitor
+ *   workspace next|prev [--wrap-around]
+ *                                 step through stdin's list, or the focused
+ *                                 monitor's workspaces
+ *   focus-monitor id|next|prev
+ *   move-workspace-to-monitor [--workspace name] id|next|prev
+ *                                 the focused workspace by default, which
+ *                                 the focus follows
+ *
+ * Anything else succeeds without output; every workspace counts as
+ * non-empty. Enough to run swipe-input's executor, to see that a hot
+ * restart keeps using the same connection, and to follow swipes across
+ * hundreds of workspaces while focus and layout change under them. */
+
+#define MAX_WORKSPACES 4096
+#define MAX_MONITORS 16
+#define NAME_MAX_LEN 32
+
+static _Atomic int next_connection = 1;
+
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+/* guarded by state_lock */
+static char names[MAX_WORKSPACES][NAME_MAX_LEN];
+static int monitor_of[MAX_WORKSPACES]; /* monitor ids count from 1 */
+static int workspace_count;
+static int monitor_count;
+static int visible[MAX_MONITORS + 1]; /* the workspace each monitor shows */
+static int focused_monitor;
+
+#define FOCUSED visible[focused_monitor]
+
+static void append(char** out, size_t* len, size_t* cap, const char* text, size_t n)
+{
+	if (*len + n + 1 > *cap) {
+		*cap = (*len + n + 1) * 2;
+		*out = realloc(*out, *cap);
+		if (!*out) {
+			fprintf(stderr, "Error: out of memory\n");
+			exit(1);
+		}
+	}
+	memcpy(*out + *len, text, n);
+	*len += n;
+	(*out)[*len] = '\0';
+}
+
+/* The listing, one line per workspace on monitor (0 for all of them) or
+ * just the focused one; the caller frees it. */
+static char* list_workspaces(const char* format, int monitor, bool focused_only)
+{
+	char* out = NULL;
+	size_t len = 0, cap = 0;
+	append(&out, &len, &cap, "", 0);
+	for (int i = 0; i < workspace_count; ++i) {
+		if ((monitor && monitor_of[i] != monitor) || (focused_only && i != FOCUSED))
+			continue;
+		char id[16];
+		snprintf(id, sizeof(id), "%d", monitor_of[i]);
+		for (const char* p = format ? format : "%{workspace}"; *p;) {
+			const char* value = NULL;
+			const char* end = strchr(p, '}');
+			if (p[0] == '%' && p[1] == '{' && end) {
+				size_t n = end - p - 2;
+				if (n == 9 && strncmp(p + 2, "workspace", n) == 0)
+					value = names[i];
+				else if (n == 20 && strncmp(p + 2, "workspace-is-focused", n) == 0)
+					value = i == FOCUSED ? "true" : "false";
+				else if (n == 10 && strncmp(p + 2, "monitor-id", n) == 0)
+					value = id;
+				else if (n == 3 && strncmp(p + 2, "tab", n) == 0)
+					value = "\t";
+				else if (n == 7 && strncmp(p + 2, "newline", n) == 0)
+					value = "\n";
+			}
+			if (value) {
+				append(&out, &len, &cap, value, strlen(value));
+				p = end + 1;
+			} else {
+				append(&out, &len, &cap, p++, 1);
+			}
+		}
+		append(&out, &len, &cap, "\n", 1);
+	}
+	return out;
+}
+
+static int find(const char* name)
+{
+	for (int i = 0; i < workspace_count; ++i)
+		if (strcmp(names[i], name) == 0)
+			return i;
+	return -1;
+}
+
+static void show(int workspace)
+{
+	focused_monitor = monitor_of[workspace];
+	visible[focused_monitor] = workspace;
+}
+
+/* id, next or prev from the focused monitor, wrapping; 0 when invalid */
+static int monitor_arg(const char* arg)
+{
+	if (!arg)
+		return 0;
+	if (strcmp(arg, "next") == 0)
+		return focused_monitor % monitor_count + 1;
+	if (strcmp(arg, "prev") == 0)
+		return (focused_monitor + monitor_count - 2) % monitor_count + 1;
+	int id = atoi(arg);
+	return id >= 1 && id <= monitor_count ? id : 0;
+}
+
+/* workspace next|prev over the names in list, or the focused monitor's;
+ * false when there is nowhere to go, as aerospace fails without
+ * --wrap-around */
+static bool step(int offset, bool wrap, const char* list)
+{
+	int order[MAX_WORKSPACES];
+	int count = 0;
+	if (list && *list) {
+		char* copy = strdup(list);
+		for (char* save = NULL, *name = strtok_r(copy, "\n", &save); name && count < MAX_WORKSPACES;
+			 name = strtok_r(NULL, "\n", &save)) {
+			int index = find(name);
+			if (index >= 0)
+				order[count++] = index;
+		}
+		free(copy);
+	} else {
+		for (int i = 0; i < workspace_count; ++i)
+			if (monitor_of[i] == focused_monitor)
+				order[count++] = i;
+	}
+
+	int at = -1;
+	for (int i = 0; i < count; ++i)
+		if (order[i] == FOCUSED)
+			at = i;
+	if (at < 0 || count == 0)
+		return false;
+	int to = at + offset;
+	if (to < 0 || to >= count) {
+		if (!wrap)
+			return false;
+		to = (to + count) % count;
+	}
+	show(order[to]);
+	return true;
+}
+
+/* The workspace leaves its monitor, which then shows the first one it has
+ * left, if any. */
+static void move_to_monitor(int workspace, int monitor)
+{
+	int from = monitor_of[workspace];
+	bool followed = workspace == FOCUSED;
+	monitor_of[workspace] = monitor;
+	if (visible[from] == workspace) {
+		for (int i = 0; i < workspace_count; ++i) {
+			if (monitor_of[i] == from) {
+				visible[from] = i;
+				break;
+			}
+		}
+	}
+	if (followed)
+		show(workspace);
+}
+
+static void answer(int conn, int id, const char* line)
+{
+	cJSON* request = cJSON_Parse(line);
+	cJSON* args = cJSON_GetObjectItem(request, "args");
+	char command[256] = "";
+	size_t len = 0;
+	cJSON* arg;
+	cJSON_ArrayForEach(arg, args)
+	{
+		if (cJSON_IsString(arg) && len + strlen(arg->valuestring) + 2 < sizeof(command))
+			len += snprintf(command + len, sizeof(command) - len, "%s%s", len ? " " : "", arg->valuestring);
+	}
+	const char* verb = cJSON_GetStringValue(cJSON_GetArrayItem(args, 0));
+	const char* target = cJSON_GetStringValue(cJSON_GetArrayItem(args, 1));
+	const char* format = NULL;
+	const char* monitor = NULL;
+	const char* moved = NULL;
+	const char* last = NULL;
+	bool wrap = false, focused_only = false;
+	for (int i = 1; i < cJSON_GetArraySize(args); ++i) {
+		const char* flag = cJSON_GetStringValue(cJSON_GetArrayItem(args, i));
+		const char* value = cJSON_GetStringValue(cJSON_GetArrayItem(args, i + 1));
+		if (!flag)
+			continue;
+		last = flag;
+		if (strcmp(flag, "--format") == 0)
+			format = value;
+		else if (strcmp(flag, "--monitor") == 0)
+			monitor = value;
+		else if (strcmp(flag, "--workspace") == 0)
+			moved = value;
+		wrap |= strcmp(flag, "--wrap-around") == 0;
+		focused_only |= strcmp(flag, "--focused") == 0;
+	}
+
+	char* out = NULL;
+	const char* error = request ? NULL : "malformed request";
+	pthread_mutex_lock(&state_lock);
+	if (verb && strcmp(verb, "list-workspaces") == 0) {
+		bool all = !monitor || strcmp(monitor, "all") == 0;
+		int id = all ? 0 : strcmp(monitor, "focused") == 0 ? focused_monitor : monitor_arg(monitor);
+		if (!all && !id)
+			error = "no such monitor";
+		else
+			out = list_workspaces(format, id, focused_only);
+	} else if (verb && strcmp(verb, "focus-monitor") == 0) {
+		int id = monitor_arg(target);
+		if (id)
+			focused_monitor = id;
+		else
+			error = "no such monitor";
+	} else if (verb && strcmp(verb, "move-workspace-to-monitor") == 0) {
+		int workspace = moved ? find(moved) : FOCUSED;
+		int id = monitor_arg(last);
+		if (workspace < 0 || !id)
+			error = workspace < 0 ? "no such workspace" : "no such monitor";
+		else
+			move_to_monitor(workspace, id);
+	} else if (verb && strcmp(verb, "workspace") == 0 && target) {
+		bool next = strcmp(target, "next") == 0;
+		if (next || strcmp(target, "prev") == 0) {
+			if (!step(next ? 1 : -1, wrap, cJSON_GetStringValue(cJSON_GetObjectItem(request, "stdin"))))
+				error = "no workspace to switch to";
+		} else if (find(target) >= 0) {
+			show(find(target));
+		} else {
+			error = "no such workspace";
+		}
+	}
+	printf("connection %d: %s%s%s (monitor %d)\n", id, request ? command : "(malformed)",
+		error ? " -> error: " : " -> ", error ? error : names[FOCUSED], focused_monitor);
+	pthread_mutex_unlock(&state_lock);
+
+	cJSON* response = cJSON_CreateObject();
+	cJSON_AddNumberToObject(response, "exitCode", error ? 1 : 0);
+	cJSON_AddStringToObject(response, "stdout", out ? out : "");
+	cJSON_AddStringToObject(response, "stderr", error ? error : "");
+	free(out);
+	char* json = cJSON_PrintUnformatted(response);
+	if (json) {
+		size_t left = strlen(json);
+		for (const char* p = json; left > 0;) {
+			ssize_t n = write(conn, p, left);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			p += n;
+			left -= n;
+		}
+	}
+	cJSON_free(json);
+	cJSON_Delete(response);
+	cJSON_Delete(request);
+}
+
+static void* serve(void* arg)
+{
+	int conn = (int)(intptr_t)arg;
+	int id = atomic_fetch_add(&next_connection, 1);
+	printf("connection %d: open\n", id);
+
+	char buf[1 << 17];
+	size_t len = 0;
+	for (;;) {
+		ssize_t n = read(conn, buf + len, sizeof(buf) - 1 - len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+		buf[len] = '\0';
+		char* line = buf;
+		for (char* end; (end = strchr(line, '\n'));) {
+			*end = '\0';
+			answer(conn, id, line);
+			line = end + 1;
+		}
+		len -= line - buf;
+		memmove(buf, line, len);
+		if (len == sizeof(buf) - 1)
+			len = 0;
+	}
+	printf("connection %d: closed\n", id);
+	close(conn);
+	return NULL;
+}
+
+int main(int argc, char** argv)
+{
+	int count = 5, monitors = 1, arg = 1;
+	for (; arg + 2 < argc; arg += 2) {
+		if (strcmp(argv[arg], "-w") == 0)
+			count = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-m") == 0)
+			monitors = atoi(argv[arg + 1]);
+		else
+			break;
+	}
+	if (arg != argc - 1 || count < 1 || count > MAX_WORKSPACES || monitors < 1 || monitors > MAX_MONITORS
+		|| monitors > count) {
+		fprintf(stderr, "usage: %s [-w workspaces] [-m monitors] socket\n", argv[0]);
+		return 2;
+	}
+	const char* path = argv[arg];
+	/* numbers up to 9, then names, so the rest are not all one digit wide */
+	for (int i = 0; i < count; ++i) {
+		snprintf(names[i], NAME_MAX_LEN, i < 9 ? "%d" : "ws-%d", i + 1);
+		monitor_of[i] = i * monitors / count + 1;
+		if (i == 0 || monitor_of[i] != monitor_of[i - 1])
+			visible[monitor_of[i]] = i;
+	}
+	workspace_count = count;
+	monitor_count = monitors;
+	focused_monitor = 1;
+	signal(SIGPIPE, SIG_IGN);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path);
+	if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+		fprintf(stderr, "Error: cannot listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	for (;;) {
+		int conn = accept(fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+			return 1;
+		}
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, serve, (void*)(intptr_t)conn) != 0) {
+			close(conn);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+}
@@ -0,0 +1,145 @@
+#include "../src/control.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Sends one request to the daemon's control socket and prints the reply.
+ * With -n it sends the request that many times over one connection, each
+ * after the previous reply, and prints round-trip percentiles instead: a
+ * load test of whatever the request exercises, e.g. "run 3 left" for the
+ * command path. */
+
+#define REPLY_MAX 65536
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* One reply line into buf, without its newline. */
+static bool read_reply(int fd, char* buf, size_t cap)
+{
+	size_t len = 0;
+	while (len + 1 < cap) {
+		ssize_t n = read(fd, buf + len, 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		if (buf[len] == '\n')
+			break;
+		len++;
+	}
+	buf[len] = '\0';
+	return true;
+}
+
+static bool send_request(int fd, const char* request, size_t len)
+{
+	for (size_t written = 0; written < len;) {
+		ssize_t n = write(fd, request + written, len - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		written += n;
+	}
+	return true;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [-S control.sock] [-n count] request...\n"
+		"requests: status | config | stats | reload | refresh | dump [path]\n"
+		"          swipe fingers direction [modifier] | run fingers direction [modifier]\n",
+		name);
+}
+
+int main(int argc, char** argv)
+{
+	char* path = NULL;
+	long count = 1;
+	int first = 1;
+	for (; first < argc; ++first) {
+		if (strcmp(argv[first], "-S") == 0 && first + 1 < argc)
+			path = strdup(argv[++first]);
+		else if (strcmp(argv[first], "-n") == 0 && first + 1 < argc)
+			count = strtol(argv[++first], NULL, 10);
+		else
+			break;
+	}
+	if (first == argc || count < 1) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (!path)
+		path = control_socket_path();
+
+	char request[512];
+	size_t len = 0;
+	for (int i = first; i < argc; ++i) {
+		int n = snprintf(request + len, sizeof(request) - len, "%s%s", i > first ? " " : "", argv[i]);
+		if (n < 0 || (size_t)n >= sizeof(request) - len - 1) {
+			fprintf(stderr, "Error: request too long\n");
+			return 2;
+		}
+		len += n;
+	}
+	request[len++] = '\n';
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Error: cannot connect to %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	free(path);
+
+	char* reply = malloc(REPLY_MAX);
+	double* round_trips = malloc(sizeof(double) * count);
+	if (!reply || !round_trips) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	int failed = 0;
+	for (long i = 0; i < count; ++i) {
+		double start = now_seconds();
+		if (!send_request(fd, request, len) || !read_reply(fd, reply, REPLY_MAX)) {
+			fprintf(stderr, "Error: the daemon closed the connection\n");
+			return 1;
+		}
+		round_trips[i] = now_seconds() - start;
+		failed += strstr(reply, "\"ok\":false") != NULL;
+	}
+	close(fd);
+
+	if (count == 1) {
+		printf("%s\n", reply);
+	} else {
+		qsort(round_trips, count, sizeof(double), compare_double);
+		printf("%ld requests, %d failed; round trip ms p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", count, failed,
+			round_trips[count / 2] * 1e3, round_trips[count * 9 / 10] * 1e3, round_trips[count * 99 / 100] * 1e3,
+			round_trips[count - 1] * 1e3);
+		printf("last reply: %s\n", reply);
+	}
+	free(reply);
+	free(round_trips);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include "../src/flight_recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Decodes a flight recorder dump into one line per record. */
+
+static const char* const direction_names[] = { "left", "right", "up", "down" };
+
+static void print_record(const flight_record* record, uint64_t dumped_ns)
+{
+	/* relative to the dump, so the last events read as "just before" */
+	double ago_ms = record->time_ns <= dumped_ns ? (dumped_ns - record->time_ns) / 1e6 : 0.0;
+	printf("-%10.3fms %-8s ", ago_ms, flight_record_type_name(record->type));
+
+	switch (record->type) {
+	case FR_FRAME:
+		printf("fingers %d  x %.3f  y %.3f  vx %.3f\n", record->fingers, record->x, record->y,
+			record->value);
+		break;
+	case FR_STATE:
+		printf("fingers %d  %s", record->fingers, flight_record_state_name(record->detail));
+		if (record->detail == FR_STATE_VERTICAL)
+			printf("  dx %.3f  dy %.3f", record->x, record->y);
+		printf("\n");
+		break;
+	case FR_TRIGGER: {
+		const char* by = "position";
+		if (record->detail & FR_BY_PREDICTION)
+			by = "prediction";
+		else if (record->detail & FR_BY_VELOCITY)
+			by = "velocity";
+		printf("fingers %d  %s by %s  dx %.3f  dy %.3f  vx %.3f\n", record->fingers,
+			direction_names[record->detail & 3], by, record->x, record->y, record->value);
+		break;
+	}
+	case FR_COMMAND:
+		printf("%s\n", (record->detail & 0xff) == FR_COMMAND_LIST ? "list-workspaces" : "run");
+		break;
+	case FR_REPLY:
+		printf("%s %s  %.1fus\n", (record->detail & 0xff) == FR_COMMAND_LIST ? "list-workspaces" : "run",
+			record->detail & FR_FAILED ? "failed" : "ok", record->value);
+		break;
+	case FR_CONFIG:
+		printf("%s\n", record->detail & FR_FAILED ? "rejected" : "reloaded");
+		break;
+	default:
+		printf("detail %u\n", record->detail);
+		break;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [dump]\n", argv[0]);
+		return 2;
+	}
+
+	char* path = argc == 2 ? strdup(argv[1]) : flight_recorder_path();
+	FILE* file = path ? fopen(path, "rb") : NULL;
+	if (!file) {
+		fprintf(stderr, "Error: cannot open %s (send SIGUSR1 to the daemon first)\n",
+			path ? path : "dump");
+		free(path);
+		return 1;
+	}
+
+	flight_dump_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "SWFR", 4) != 0
+		|| header.version != FLIGHT_DUMP_VERSION || header.record_size != sizeof(flight_record)) {
+		fprintf(stderr, "Error: %s is not a flight recorder dump.\n", path);
+		fclose(file);
+		free(path);
+		return 1;
+	}
+
+	flight_record record;
+	uint32_t count = 0;
+	while (count < header.count && fread(&record, sizeof(record), 1, file) == 1) {
+		print_record(&record, header.dumped_ns);
+		++count;
+	}
+	printf("%u records\n", count);
+
+	fclose(file);
+	free(path);
+	return count == header.count ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+#include "../src/aerospace.h"
+#include "../src/config.h"
+#include "../src/contact_table.h"
+#include "../src/control.h"
+#include "../src/devices.h"
+#include "../src/executor.h"
+#include "../src/haptic_queue.h"
+#include "../src/handoff.h"
+#include "../src/input.h"
+#include "../src/log.h"
+#include "../src/recognizer.h"
+#include "../src/stats.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The daemon's pipeline on a portable input backend: contact table,
+ * recognizer, executor and haptic queue (null backend), timed into the same
+ * stats as the daemon. Without -s commands are only logged, so input to
+ * decision latency can be measured with no aerospace at all.
+ *
+ * Several sources may be given; each is read on its own thread and routed
+ * to its own recognizer like a second trackpad would be.
+ *
+ * --handoff and --take-over play the daemon's hot restart between two
+ * instances: the second one takes the first one's aerospace connection and
+ * gesture state and the first one exits.
+ *
+ * The control socket is served as by the daemon, except for reload: the
+ * config given with -c is fixed for the run. */
+
+typedef struct {
+	input_backend input;
+	pthread_t thread;
+} source;
+
+static Config config;
+/* with -s, NULL until the background connect gets through */
+static _Atomic(Aerospace*) client;
+static bool dry_run = true;
+static haptic_queue* haptics;
+static bool quiet;
+static bool prefilter = true;
+static _Atomic uint64_t frames, triggers;
+
+static void print_totals(void)
+{
+	fprintf(stderr, "%llu frames, %llu triggers\n", (unsigned long long)atomic_load(&frames),
+		(unsigned long long)atomic_load(&triggers));
+}
+
+static bool release(handoff_state* state)
+{
+	executor_pause();
+	state->device_count = devices_save(state->devices, MAX_DEVICES);
+	state->aerospace_fd = aerospace_fd(atomic_load(&client));
+	return true;
+}
+
+static void resume(void)
+{
+	executor_resume();
+}
+
+static void finish(void)
+{
+	fprintf(stderr, "handed over\n");
+	print_totals();
+	log_flush();
+	exit(0);
+}
+
+static const Config* current_config(void)
+{
+	return &config;
+}
+
+/* what run_source does with a binding */
+static void run_binding(gesture_device* device, const Config* config, const Binding* binding, uint64_t event_ns)
+{
+	atomic_fetch_add_explicit(&triggers, 1, memory_order_relaxed);
+	if (config->haptic && config->haptic_policy == HAPTIC_ON_RECOGNITION)
+		haptic_queue_post(device->haptics, 3);
+	Aerospace* aerospace = atomic_load_explicit(&client, memory_order_acquire);
+	if (!aerospace && !dry_run) {
+		log_warn("Not connected to aerospace yet, dropping '%s'.", binding->label);
+		stats_count(COUNTER_DROPS);
+		return;
+	}
+	execute_binding(aerospace, device->haptics, config, binding, event_ns);
+}
+
+static void aerospace_connected(Aerospace* connected)
+{
+	atomic_store_explicit(&client, connected, memory_order_release);
+	stats_phase_done(PHASE_AEROSPACE);
+}
+
+static void add_status(cJSON* reply)
+{
+	cJSON_AddBoolToObject(reply, "aerospace", atomic_load(&client) != NULL);
+	cJSON_AddNumberToObject(reply, "frames", (double)atomic_load(&frames));
+	cJSON_AddNumberToObject(reply, "triggers", (double)atomic_load(&triggers));
+}
+
+static haptic_queue* shared_haptics(uint64_t id)
+{
+	(void)id;
+	return haptics;
+}
+
+static void* run_source(void* arg)
+{
+	input_backend* input = arg;
+	/* each source has its own contact ids */
+	contact_table contacts;
+	contact_table_init(&contacts);
+
+	input_frame frame;
+	touch_frame converted;
+	while (input->next(input->source, &frame)) {
+		uint64_t event_ns = (uint64_t)(frame.touches[0].timestamp * 1e9);
+		uint64_t start = stats_now_ns();
+		stats_record(STAGE_EVENT_TAP, start > event_ns ? start - event_ns : 0);
+		stats_count(COUNTER_FRAMES);
+		stats_phase_done(PHASE_FIRST_FRAME);
+		atomic_fetch_add_explicit(&frames, 1, memory_order_relaxed);
+
+		gesture_device* device = devices_get(frame.device);
+		if (!device) {
+			stats_count(COUNTER_DROPS);
+			continue;
+		}
+		pthread_mutex_lock(&device->lock);
+		/* the generation still moves on: a contact skipped for long goes
+		 * stale and comes back with a fresh velocity window, a short skip
+		 * only leaves a gap between real samples */
+		contact_table_next_frame(&contacts);
+		if (prefilter && recognizer_prefilter(&device->gesture, &config, frame.count, frame.touches[0].timestamp)) {
+			pthread_mutex_unlock(&device->lock);
+			stats_count(COUNTER_PREFILTERED);
+			stats_add(COUNTER_UNCONVERTED, frame.count);
+			stats_record(STAGE_RECOGNITION, stats_now_ns() - start);
+			continue;
+		}
+		touch_frame_init(&converted, frame.device, frame.touches[0].timestamp);
+		for (int i = 0; i < frame.count; ++i) {
+			const touch* in = &frame.touches[i];
+			touch contact = contact_table_convert(&contacts, in->id, in->x, in->y, in->phase, in->timestamp);
+			touch_frame_add(&converted, &contact);
+		}
+		uint64_t converted_ns = stats_now_ns();
+		stats_record(STAGE_TOUCH_CONVERT, converted_ns - start);
+
+		const Binding* binding = recognizer_feed(&device->gesture, &config, &converted, MODIFIER_NONE);
+		stats_record(STAGE_RECOGNITION, stats_now_ns() - converted_ns);
+		pthread_mutex_unlock(&device->lock);
+		if (!binding)
+			continue;
+
+		if (!quiet)
+			printf("%.3f  %s  %s\n", frame.touches[0].timestamp, input->name, binding->label);
+		run_binding(device, &config, binding, event_ns);
+	}
+	return NULL;
+}
+
+static char* read_file(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* buffer = len >= 0 ? malloc(len + 1) : NULL;
+	if (buffer && fread(buffer, 1, len, file) != (size_t)len) {
+		free(buffer);
+		buffer = NULL;
+	}
+	if (buffer)
+		buffer[len] = '\0';
+	fclose(file);
+	return buffer;
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [-c config.json] [-s aerospace.sock] [-q] [--no-prefilter]\n"
+		"       [--handoff handoff.sock] [--take-over handoff.sock]\n"
+		"       ((--evdev /dev/input/eventN | --trace file [--speed x])... | --stdin)\n",
+		name);
+}
+
+int main(int argc, char** argv)
+{
+	stats_startup_begin();
+	const char* config_file = NULL;
+	const char* socket_path = NULL;
+	const char* serve_path = NULL;
+	const char* take_path = NULL;
+	source sources[MAX_DEVICES];
+	int source_count = 0;
+	bool from_stdin = false;
+	double speed = 1.0;
+
+	/* --speed applies to every trace, wherever it is given */
+	for (int i = 1; i + 1 < argc; ++i)
+		if (strcmp(argv[i], "--speed") == 0)
+			speed = atof(argv[i + 1]);
+
+	for (int i = 1; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+		bool is_source = (strcmp(argv[i], "--evdev") == 0 || strcmp(argv[i], "--trace") == 0) && has_value;
+		if (strcmp(argv[i], "-c") == 0 && has_value) {
+			config_file = argv[++i];
+		} else if (strcmp(argv[i], "-s") == 0 && has_value) {
+			socket_path = argv[++i];
+		} else if (strcmp(argv[i], "-q") == 0) {
+			quiet = true;
+		} else if (strcmp(argv[i], "--no-prefilter") == 0) {
+			prefilter = false;
+		} else if (strcmp(argv[i], "--handoff") == 0 && has_value) {
+			serve_path = argv[++i];
+		} else if (strcmp(argv[i], "--take-over") == 0 && has_value) {
+			take_path = argv[++i];
+		} else if (is_source && source_count < MAX_DEVICES) {
+			bool evdev = strcmp(argv[i], "--evdev") == 0;
+			const char* path = argv[++i];
+			input_backend* input = &sources[source_count].input;
+			if (!(evdev ? input_open_evdev(path, input) : input_open_trace(path, speed, input)))
+				return 1;
+			source_count++;
+		} else if (strcmp(argv[i], "--speed") == 0 && has_value) {
+			++i;
+		} else if (strcmp(argv[i], "--stdin") == 0) {
+			from_stdin = true;
+		} else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (from_stdin == (source_count > 0)) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (from_stdin && !input_open_stream(stdin, "stdin", &sources[source_count++].input))
+		return 1;
+
+	config = default_config();
+	if (config_file) {
+		char* json = read_file(config_file);
+		Config parsed;
+		if (!json || !config_parse(json, &parsed)) {
+			fprintf(stderr, "Error: cannot load config %s\n", config_file);
+			free(json);
+			return 1;
+		}
+		free(json);
+		config_free(&config);
+		config = parsed;
+	}
+	stats_phase_done(PHASE_CONFIG);
+	log_start();
+	log_set_level(config.log_level);
+	signal(SIGPIPE, SIG_IGN);
+
+	int takeover = -1;
+	if (take_path && (takeover = handoff_connect(take_path)) < 0) {
+		fprintf(stderr, "Error: nothing to take over at %s\n", take_path);
+		return 1;
+	}
+
+	haptics = haptic_queue_start(haptic_null_backend());
+	stats_phase_done(PHASE_HAPTICS);
+	devices_init(shared_haptics);
+	handoff_state handed = { .aerospace_fd = -1 };
+	if (takeover >= 0) {
+		if (!handoff_take(takeover, &handed))
+			return 1;
+		for (int i = 0; i < handed.device_count; ++i)
+			devices_restore(&handed.devices[i]);
+		fprintf(stderr, "took over %d device(s)%s\n", handed.device_count,
+			handed.aerospace_fd >= 0 ? " and the aerospace connection" : "");
+	}
+	/* like the daemon, start without waiting for aerospace */
+	dry_run = !socket_path && handed.aerospace_fd < 0;
+	if (handed.aerospace_fd >= 0)
+		aerospace_connected(aerospace_adopt(handed.aerospace_fd, socket_path));
+	else if (socket_path && !aerospace_connect_async(socket_path, aerospace_connected))
+		return 1;
+	char* stats_path = stats_socket_path();
+	if (stats_path)
+		stats_server_start(stats_path);
+	free(stats_path);
+	static const control_hooks control = { current_config, NULL, NULL, run_binding, add_status };
+	char* control_path = control_socket_path();
+	if (control_path)
+		control_server_start(control_path, &control);
+	free(control_path);
+
+	for (int i = 0; i < source_count; ++i) {
+		if (pthread_create(&sources[i].thread, NULL, run_source, &sources[i].input) != 0) {
+			fprintf(stderr, "Error: cannot start a thread for %s\n", sources[i].input.name);
+			return 1;
+		}
+	}
+	stats_phase_done(PHASE_INPUT);
+	if (takeover >= 0)
+		handoff_confirm(takeover);
+	static const handoff_hooks hooks = { release, resume, finish };
+	if (serve_path && !handoff_serve(serve_path, &hooks))
+		return 1;
+	for (int i = 0; i < source_count; ++i) {
+		pthread_join(sources[i].thread, NULL);
+		input_close(&sources[i].input);
+	}
+
+	devices_stop(haptics);
+	haptic_queue_stop(haptics);
+	aerospace_close(atomic_load(&client));
+
+	char* snapshot = stats_snapshot_json();
+	print_totals();
+	if (snapshot)
+		fprintf(stderr, "%s\n", snapshot);
+	free(snapshot);
+	config_free(&config);
+	log_flush();
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include "../src/config.h"
+#include "../src/replay.h"
+#include "../src/touch_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Replays recorded traces through the stock recognizer and a candidate
+ * config (prediction enabled unless the config says otherwise) and reports
+ * accuracy and time to trigger for both. */
+
+static char* read_file(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* buffer = len >= 0 ? malloc(len + 1) : NULL;
+	if (buffer && fread(buffer, 1, len, file) != (size_t)len) {
+		free(buffer);
+		buffer = NULL;
+	}
+	if (buffer)
+		buffer[len] = '\0';
+	fclose(file);
+	return buffer;
+}
+
+static void print_score(const char* name, replay_score score)
+{
+	printf("%-12s %8d/%-5d %6d %7d %8d/%-5d %8.1f %8.1f %8.1f\n", name, score.detected, score.swipes,
+		score.wrong, score.missed, score.false_positives, score.nones, score.mean_ms, score.p50_ms,
+		score.p90_ms);
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+	const char* config_file = NULL;
+	double horizon_ms = 0.0, confidence = -1.0;
+	int first_trace = argc;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			config_file = argv[++i];
+		} else if (strcmp(argv[i], "--horizon") == 0 && i + 1 < argc) {
+			horizon_ms = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--confidence") == 0 && i + 1 < argc) {
+			confidence = atof(argv[++i]);
+		} else if (argv[i][0] == '-') {
+			first_trace = argc;
+			break;
+		} else {
+			first_trace = i;
+			break;
+		}
+	}
+	if (first_trace >= argc) {
+		fprintf(stderr, "usage: %s [-c config.json] [--horizon ms] [--confidence r2] trace...\n", argv[0]);
+		return 2;
+	}
+
+	Config candidate = default_config();
+	if (config_file) {
+		char* json = read_file(config_file);
+		Config parsed;
+		if (!json || !config_parse(json, &parsed)) {
+			fprintf(stderr, "Error: cannot load config %s\n", config_file);
+			free(json);
+			return 1;
+		}
+		free(json);
+		config_free(&candidate);
+		candidate = parsed;
+	}
+	if (!config_file || horizon_ms > 0 || confidence >= 0)
+		candidate.prediction.enabled = true;
+	if (horizon_ms > 0)
+		candidate.prediction.horizon = (float)(horizon_ms / 1000.0);
+	if (confidence >= 0)
+		candidate.prediction.confidence = (float)confidence;
+
+	/* the stock recognizer shares the candidate's bindings */
+	Config baseline = candidate;
+	baseline.prediction.enabled = false;
+
+	replay_corpus corpus;
+	memset(&corpus, 0, sizeof(corpus));
+	for (int i = first_trace; i < argc; ++i) {
+		if (!replay_corpus_load(&corpus, argv[i])) {
+			replay_corpus_free(&corpus);
+			config_free(&candidate);
+			return 1;
+		}
+	}
+
+	replay_outcome* base = calloc(corpus.gesture_count + 1, sizeof(replay_outcome));
+	replay_outcome* pred = calloc(corpus.gesture_count + 1, sizeof(replay_outcome));
+	double* saved = calloc(corpus.gesture_count + 1, sizeof(double));
+	if (!base || !pred || !saved) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	replay_run(&corpus, &baseline, base);
+	replay_run(&corpus, &candidate, pred);
+
+	printf("%zu gestures, %zu frames from %d trace(s); prediction %s, horizon %.0f ms, confidence %.2f\n\n",
+		corpus.gesture_count, corpus.frame_count, corpus.files,
+		candidate.prediction.enabled ? "on" : "off", candidate.prediction.horizon * 1e3,
+		candidate.prediction.confidence);
+	printf("%-12s %14s %6s %7s %14s %8s %8s %8s\n", "", "detected", "wrong", "missed", "false+",
+		"mean ms", "p50 ms", "p90 ms");
+	print_score("stock", replay_score_outcomes(&corpus, base, base));
+	replay_score score = replay_score_outcomes(&corpus, pred, base);
+	print_score("candidate", score);
+
+	/* per swipe both got right: how much sooner the candidate fired */
+	int n = 0, earlier = 0;
+	double sum = 0.0;
+	for (size_t g = 0; g < corpus.gesture_count; ++g) {
+		if (corpus.gestures[g].label == TRACE_NONE || base[g].direction < 0
+			|| base[g].direction != pred[g].direction)
+			continue;
+		saved[n] = (base[g].latency - pred[g].latency) * 1e3;
+		sum += saved[n];
+		earlier += saved[n] > 0.0;
+		n++;
+	}
+	if (n > 0) {
+		qsort(saved, n, sizeof(double), compare_double);
+		printf("\nsaved per swipe: mean %.1f ms, p50 %.1f ms, p90 %.1f ms; %d of %d fired earlier, %d by prediction\n",
+			sum / n, saved[n / 2], saved[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1], earlier, n, score.predicted);
+	}
+
+	free(base);
+	free(pred);
+	free(saved);
+	replay_corpus_free(&corpus);
+	config_free(&candidate);
+	return 0;
+}
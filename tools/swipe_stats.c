@@ -0,0 +1,132 @@
+#include "../src/cJSON.h"
+#include "../src/stats.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Reads a snapshot from the daemon's stats socket and prints it. */
+
+static char* fetch_snapshot(const char* path)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "Error: cannot connect to %s: %s\n", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return NULL;
+	}
+
+	size_t cap = 4096, len = 0;
+	char* buf = malloc(cap);
+	while (buf) {
+		if (len + 1 == cap) {
+			char* grown = realloc(buf, cap * 2);
+			if (!grown) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = grown;
+			cap *= 2;
+		}
+		ssize_t n = read(fd, buf + len, cap - len - 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+	}
+	close(fd);
+	if (buf)
+		buf[len] = '\0';
+	return buf;
+}
+
+static double number(const cJSON* object, const char* key)
+{
+	return cJSON_GetNumberValue(cJSON_GetObjectItem(object, key));
+}
+
+static int print_table(const char* json)
+{
+	cJSON* root = cJSON_Parse(json);
+	if (!root) {
+		fprintf(stderr, "Error: malformed snapshot.\n");
+		return 1;
+	}
+
+	printf("uptime %.0fs\n", number(root, "uptime_s"));
+	cJSON* item;
+	if (cJSON_GetArraySize(cJSON_GetObjectItem(root, "startup")) > 0) {
+		printf("startup");
+		cJSON_ArrayForEach(item, cJSON_GetObjectItem(root, "startup"))
+			printf("  %.*s %.1f", (int)(strlen(item->string) - 3), item->string, item->valuedouble);
+		printf(" (ms)\n");
+	}
+	cJSON_ArrayForEach(item, cJSON_GetObjectItem(root, "counters"))
+		printf("  %-12s %12.0f\n", item->string, item->valuedouble);
+
+	printf("\n%-16s %10s %10s %10s %10s %10s %10s\n", "stage (us)", "count", "p50", "p90",
+		"p99", "p99.9", "max");
+	cJSON_ArrayForEach(item, cJSON_GetObjectItem(root, "stages"))
+		printf("%-16s %10.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n", item->string,
+			number(item, "count"), number(item, "p50_us"), number(item, "p90_us"),
+			number(item, "p99_us"), number(item, "p999_us"), number(item, "max_us"));
+
+	cJSON_Delete(root);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int raw = 0;
+	int watch = 0;
+	char* path = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0) {
+			raw = 1;
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			watch = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			path = strdup(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [--json] [-w seconds] [-s socket]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (!path)
+		path = stats_socket_path();
+
+	int rc = 0;
+	do {
+		char* json = fetch_snapshot(path);
+		if (!json) {
+			rc = 1;
+			break;
+		}
+		if (raw)
+			printf("%s\n", json);
+		else
+			rc = print_table(json);
+		free(json);
+		fflush(stdout);
+		if (watch > 0) {
+			sleep(watch);
+			if (!raw)
+				printf("\n");
+		}
+	} while (watch > 0 && rc == 0);
+
+	free(path);
+	return rc;
+}
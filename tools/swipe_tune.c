@@ -0,0 +1,348 @@
+#include "../src/cJSON.h"
+#include "../src/config.h"
+#include "../src/replay.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Sweeps the recognizer thresholds over a labelled trace corpus on every
+ * core and writes the best setting as a config. Each setting is scored as
+ *
+ *   detection rate - fp_weight * false positive rate - ms_weight * mean ms
+ *
+ * so with the defaults one false positive in a hundred gestures costs as much
+ * as two missed swipes in a hundred, or 20ms of time to trigger. */
+
+typedef struct {
+	double min, max, step;
+} range;
+
+typedef struct {
+	thresholds limits;
+	replay_score score;
+	double objective;
+	double distance; /* from the input thresholds, to break ties */
+} setting;
+
+static const replay_corpus* corpus;
+static const Config* base;
+static setting* settings;
+static size_t setting_count;
+static _Atomic size_t next_setting;
+static double fp_weight = 2.0;
+static double ms_weight = 0.001;
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool parse_range(const char* text, range* out)
+{
+	range r;
+	if (sscanf(text, "%lf:%lf:%lf", &r.min, &r.max, &r.step) == 3 && r.min > 0 && r.max >= r.min
+		&& r.step > 0) {
+		*out = r;
+		return true;
+	}
+	if (sscanf(text, "%lf", &r.min) == 1 && r.min > 0) {
+		r.max = r.min;
+		r.step = 1.0;
+		*out = r;
+		return true;
+	}
+	fprintf(stderr, "Error: '%s' is not min:max:step or a single value\n", text);
+	return false;
+}
+
+static int range_steps(range r)
+{
+	/* tolerate the rounding of a step that divides the range exactly */
+	return (int)((r.max - r.min) / r.step + 1e-6) + 1;
+}
+
+static double objective(replay_score score)
+{
+	double detection = score.swipes ? (double)score.detected / score.swipes : 0.0;
+	double false_rate = score.nones ? (double)score.false_positives / score.nones : 0.0;
+	return detection - fp_weight * false_rate - ms_weight * score.mean_ms;
+}
+
+static void* worker(void* arg)
+{
+	(void)arg;
+	replay_outcome* outcomes = malloc(sizeof(replay_outcome) * (corpus->gesture_count + 1));
+	if (!outcomes)
+		return NULL;
+
+	/* bindings are only read, so every worker can share them */
+	Config config = *base;
+	for (;;) {
+		size_t i = atomic_fetch_add_explicit(&next_setting, 1, memory_order_relaxed);
+		if (i >= setting_count)
+			break;
+		for (int f = 0; f <= MAX_FINGERS; ++f)
+			config.thresholds[f] = settings[i].limits;
+		replay_run(corpus, &config, outcomes);
+		settings[i].score = replay_score_outcomes(corpus, outcomes, NULL);
+		settings[i].objective = objective(settings[i].score);
+	}
+	free(outcomes);
+	return NULL;
+}
+
+/* best objective first; among equals, the smallest change to the input */
+static int compare_settings(const void* a, const void* b)
+{
+	const setting *x = a, *y = b;
+	if (x->objective != y->objective)
+		return x->objective < y->objective ? 1 : -1;
+	return (x->distance > y->distance) - (x->distance < y->distance);
+}
+
+static double distance(thresholds a, thresholds b)
+{
+	return fabs(a.swipe - b.swipe) / b.swipe + fabs(a.velocity - b.velocity) / b.velocity
+		+ fabs(a.cooldown - b.cooldown) / b.cooldown;
+}
+
+static char* read_file(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* buffer = len >= 0 ? malloc(len + 1) : NULL;
+	if (buffer && fread(buffer, 1, len, file) != (size_t)len) {
+		free(buffer);
+		buffer = NULL;
+	}
+	if (buffer)
+		buffer[len] = '\0';
+	fclose(file);
+	return buffer;
+}
+
+/* The input config (or an empty object) with "thresholds" replaced; the
+ * sweep applies one setting to every finger count, so profiles and per
+ * finger overrides go too. */
+static bool write_config(const char* path, const char* json, thresholds best)
+{
+	cJSON* root = json ? cJSON_Parse(json) : cJSON_CreateObject();
+	if (!root)
+		return false;
+	/* the grid is in round numbers; don't print their float error */
+	cJSON* limits = cJSON_CreateObject();
+	cJSON_AddItemToObject(limits, "swipe", cJSON_CreateNumber(round(best.swipe * 1e4) / 1e4));
+	cJSON_AddItemToObject(limits, "velocity", cJSON_CreateNumber(round(best.velocity * 1e4) / 1e4));
+	cJSON_AddItemToObject(limits, "cooldown_ms", cJSON_CreateNumber(round(best.cooldown * 1e4) / 10));
+	cJSON_AddItemToObject(limits, "grace_ms", cJSON_CreateNumber(round(best.grace * 1e4) / 10));
+	if (cJSON_GetObjectItem(root, "thresholds"))
+		cJSON_ReplaceItemInObject(root, "thresholds", limits);
+	else
+		cJSON_AddItemToObject(root, "thresholds", limits);
+
+	char* text = cJSON_Print(root);
+	cJSON_Delete(root);
+	if (!text)
+		return false;
+
+	bool ok;
+	if (strcmp(path, "-") == 0) {
+		ok = printf("%s\n", text) > 0;
+	} else {
+		FILE* file = fopen(path, "w");
+		ok = file && fprintf(file, "%s\n", text) > 0;
+		if (file)
+			ok = fclose(file) == 0 && ok;
+	}
+	cJSON_free(text);
+	return ok;
+}
+
+static void print_setting(const setting* s)
+{
+	printf("%6.3f %8.2f %8.0f %8d/%-5d %5d %6d %6d/%-5d %7.1f %7.1f %9.4f\n", s->limits.swipe,
+		s->limits.velocity, s->limits.cooldown * 1e3, s->score.detected, s->score.swipes, s->score.wrong,
+		s->score.missed, s->score.false_positives, s->score.nones, s->score.mean_ms, s->score.p90_ms,
+		s->objective);
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [-c config.json] [-o out.json|-] [-j threads] [--swipe min:max:step]\n"
+		"       [--velocity min:max:step] [--cooldown-ms min:max:step] [--fp-weight w] [--ms-weight w]\n"
+		"       trace...\n",
+		name);
+}
+
+int main(int argc, char** argv)
+{
+	const char* config_file = NULL;
+	const char* out_file = NULL;
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	range swipe = { 0.06, 0.30, 0.01 };
+	range velocity = { 0.30, 1.50, 0.05 };
+	range cooldown = { 150, 500, 50 };
+	int first_trace = argc;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		bool has_value = i + 1 < argc;
+		bool ok = true;
+		if (strcmp(arg, "-c") == 0 && has_value) {
+			config_file = argv[++i];
+		} else if (strcmp(arg, "-o") == 0 && has_value) {
+			out_file = argv[++i];
+		} else if (strcmp(arg, "-j") == 0 && has_value) {
+			threads = atol(argv[++i]);
+		} else if (strcmp(arg, "--swipe") == 0 && has_value) {
+			ok = parse_range(argv[++i], &swipe);
+		} else if (strcmp(arg, "--velocity") == 0 && has_value) {
+			ok = parse_range(argv[++i], &velocity);
+		} else if (strcmp(arg, "--cooldown-ms") == 0 && has_value) {
+			ok = parse_range(argv[++i], &cooldown);
+		} else if (strcmp(arg, "--fp-weight") == 0 && has_value) {
+			fp_weight = atof(argv[++i]);
+		} else if (strcmp(arg, "--ms-weight") == 0 && has_value) {
+			ms_weight = atof(argv[++i]);
+		} else if (arg[0] == '-') {
+			ok = false;
+		} else {
+			first_trace = i;
+			break;
+		}
+		if (!ok) {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (first_trace >= argc) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (threads < 1)
+		threads = 1;
+
+	char* json = NULL;
+	Config config = default_config();
+	if (config_file) {
+		json = read_file(config_file);
+		Config parsed;
+		if (!json || !config_parse(json, &parsed)) {
+			fprintf(stderr, "Error: cannot load config %s\n", config_file);
+			free(json);
+			return 1;
+		}
+		config_free(&config);
+		config = parsed;
+	}
+	base = &config;
+
+	replay_corpus loaded;
+	memset(&loaded, 0, sizeof(loaded));
+	double load_start = now_seconds();
+	for (int i = first_trace; i < argc; ++i) {
+		if (!replay_corpus_load(&loaded, argv[i])) {
+			replay_corpus_free(&loaded);
+			config_free(&config);
+			free(json);
+			return 1;
+		}
+	}
+	corpus = &loaded;
+	double load_time = now_seconds() - load_start;
+
+	int swipe_steps = range_steps(swipe), velocity_steps = range_steps(velocity),
+		cooldown_steps = range_steps(cooldown);
+	setting_count = (size_t)swipe_steps * velocity_steps * cooldown_steps;
+	settings = calloc(setting_count, sizeof(setting));
+	if (!settings) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	size_t n = 0;
+	for (int s = 0; s < swipe_steps; ++s)
+		for (int v = 0; v < velocity_steps; ++v)
+			for (int c = 0; c < cooldown_steps; ++c) {
+				settings[n].limits = config.thresholds[config.fingers];
+				settings[n].limits.swipe = (float)(swipe.min + s * swipe.step);
+				settings[n].limits.velocity = (float)(velocity.min + v * velocity.step);
+				settings[n].limits.cooldown = (float)((cooldown.min + c * cooldown.step) / 1000.0);
+				settings[n].distance = distance(settings[n].limits, config.thresholds[config.fingers]);
+				n++;
+			}
+
+	/* the stock thresholds, scored the same way, for comparison */
+	setting stock = { .limits = config.thresholds[config.fingers] };
+	{
+		replay_outcome* outcomes = malloc(sizeof(replay_outcome) * (loaded.gesture_count + 1));
+		if (!outcomes) {
+			fprintf(stderr, "Error: out of memory\n");
+			return 1;
+		}
+		replay_run(&loaded, &config, outcomes);
+		stock.score = replay_score_outcomes(&loaded, outcomes, NULL);
+		stock.objective = objective(stock.score);
+		free(outcomes);
+	}
+
+	pthread_t* pool = malloc(sizeof(pthread_t) * threads);
+	if (!pool) {
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	double sweep_start = now_seconds();
+	long started = 0;
+	for (; started < threads; ++started)
+		if (pthread_create(&pool[started], NULL, worker, NULL) != 0)
+			break;
+	if (started == 0)
+		worker(NULL);
+	for (long t = 0; t < started; ++t)
+		pthread_join(pool[t], NULL);
+	double sweep_time = now_seconds() - sweep_start;
+	free(pool);
+
+	double frames = (double)loaded.frame_count * setting_count;
+	printf("%zu gestures, %zu frames from %d trace(s), loaded in %.2f s\n", loaded.gesture_count,
+		loaded.frame_count, loaded.files, load_time);
+	printf("%zu settings on %ld threads in %.2f s: %.1f M frames/s, %.0f ns per frame per thread\n\n",
+		setting_count, started ? started : 1, sweep_time, frames / sweep_time / 1e6,
+		sweep_time * (started ? started : 1) / frames * 1e9);
+
+	qsort(settings, setting_count, sizeof(setting), compare_settings);
+	printf("%6s %8s %8s %14s %5s %6s %12s %7s %7s %9s\n", "swipe", "velocity", "cooldown", "detected",
+		"wrong", "missed", "false+", "mean ms", "p90 ms", "objective");
+	printf("stock:\n");
+	print_setting(&stock);
+	printf("best:\n");
+	for (size_t i = 0; i < setting_count && i < 10; ++i)
+		print_setting(&settings[i]);
+
+	int status = 0;
+	if (out_file) {
+		if (setting_count && !write_config(out_file, json, settings[0].limits)) {
+			fprintf(stderr, "Error: cannot write %s\n", out_file);
+			status = 1;
+		} else if (strcmp(out_file, "-") != 0) {
+			printf("\nwrote %s\n", out_file);
+		}
+	}
+
+	free(settings);
+	free(json);
+	replay_corpus_free(&loaded);
+	config_free(&config);
+	return status;
+}
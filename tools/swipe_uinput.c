@@ -0,0 +1,174 @@
+#include "../src/touch_trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Creates a virtual MT protocol B touchpad through /dev/uinput and plays a
+ * touch trace into it at its recorded pace, so swipe-input --evdev can run
+ * against a real kernel input device. Needs write access to /dev/uinput. */
+
+#define RANGE 4096
+#define SLOTS 16
+
+static int device;
+
+static void emit(int type, int code, int value)
+{
+	struct input_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	if (write(device, &ev, sizeof(ev)) != sizeof(ev))
+		fprintf(stderr, "Error: uinput write: %s\n", strerror(errno));
+}
+
+static void add_axis(int code, int max)
+{
+	struct uinput_abs_setup abs;
+	memset(&abs, 0, sizeof(abs));
+	abs.code = code;
+	abs.absinfo.maximum = max;
+	ioctl(device, UI_SET_ABSBIT, code);
+	ioctl(device, UI_ABS_SETUP, &abs);
+}
+
+static void sleep_seconds(double seconds)
+{
+	struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+	nanosleep(&ts, NULL);
+}
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s trace [seconds to wait for readers]\n", argv[0]);
+		return 2;
+	}
+	double settle = argc > 2 ? atof(argv[2]) : 1.0;
+
+	FILE* file = fopen(argv[1], "r");
+	if (!file) {
+		fprintf(stderr, "Error: cannot open %s\n", argv[1]);
+		return 1;
+	}
+	device = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (device < 0) {
+		fprintf(stderr, "Error: cannot open /dev/uinput: %s\n", strerror(errno));
+		return 1;
+	}
+
+	ioctl(device, UI_SET_EVBIT, EV_SYN);
+	ioctl(device, UI_SET_EVBIT, EV_KEY);
+	ioctl(device, UI_SET_KEYBIT, BTN_TOUCH);
+	ioctl(device, UI_SET_EVBIT, EV_ABS);
+	ioctl(device, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+	add_axis(ABS_MT_SLOT, SLOTS - 1);
+	add_axis(ABS_MT_TRACKING_ID, 65535);
+	add_axis(ABS_MT_POSITION_X, RANGE);
+	add_axis(ABS_MT_POSITION_Y, RANGE);
+
+	struct uinput_setup setup;
+	memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x1;
+	setup.id.product = 0x1;
+	snprintf(setup.name, sizeof(setup.name), "aerospace-swipe virtual touchpad");
+	if (ioctl(device, UI_DEV_SETUP, &setup) < 0 || ioctl(device, UI_DEV_CREATE) < 0) {
+		fprintf(stderr, "Error: cannot create the uinput device: %s\n", strerror(errno));
+		return 1;
+	}
+	char sysname[64];
+	if (ioctl(device, UI_GET_SYSNAME(sizeof(sysname)), sysname) >= 0)
+		printf("device /sys/devices/virtual/input/%s (see its event* entry)\n", sysname);
+	fflush(stdout);
+
+	/* give readers time to open the new event node */
+	sleep_seconds(settle);
+
+	uint64_t slot_ids[SLOTS];
+	bool used[SLOTS] = { false };
+	bool seen[SLOTS];
+	int tracking_id = 0;
+
+	trace_reader reader;
+	touch_trace_reader_init(&reader, file, argv[1]);
+	trace_frame frame;
+	double start = now_seconds(), first = -1.0;
+	int frames = 0;
+	while (touch_trace_next(&reader, &frame)) {
+		if (frame.count == 0)
+			continue;
+		double t = frame.touches[0].timestamp;
+		if (first < 0.0)
+			first = t;
+		double wait = (t - first) - (now_seconds() - start);
+		if (wait > 0.0)
+			sleep_seconds(wait);
+
+		memset(seen, 0, sizeof(seen));
+		for (int i = 0; i < frame.count; ++i) {
+			const touch* contact = &frame.touches[i];
+			int slot = -1;
+			for (int s = 0; s < SLOTS && slot < 0; ++s)
+				if (used[s] && slot_ids[s] == contact->id)
+					slot = s;
+			if (slot < 0) {
+				for (int s = 0; s < SLOTS && slot < 0; ++s)
+					if (!used[s])
+						slot = s;
+				if (slot < 0)
+					continue;
+				used[slot] = true;
+				slot_ids[slot] = contact->id;
+				emit(EV_ABS, ABS_MT_SLOT, slot);
+				emit(EV_ABS, ABS_MT_TRACKING_ID, tracking_id++ & 0xffff);
+			} else {
+				emit(EV_ABS, ABS_MT_SLOT, slot);
+			}
+			seen[slot] = true;
+			emit(EV_ABS, ABS_MT_POSITION_X, (int)(contact->x * RANGE));
+			/* trace y grows upwards, evdev y downwards */
+			emit(EV_ABS, ABS_MT_POSITION_Y, (int)((1.0 - contact->y) * RANGE));
+			if (contact->phase & (TOUCH_PHASE_ENDED | TOUCH_PHASE_CANCELLED)) {
+				emit(EV_ABS, ABS_MT_TRACKING_ID, -1);
+				used[slot] = false;
+			}
+		}
+		/* contacts that vanished without an end phase */
+		for (int s = 0; s < SLOTS; ++s) {
+			if (used[s] && !seen[s]) {
+				emit(EV_ABS, ABS_MT_SLOT, s);
+				emit(EV_ABS, ABS_MT_TRACKING_ID, -1);
+				used[s] = false;
+			}
+		}
+		bool touching = false;
+		for (int s = 0; s < SLOTS; ++s)
+			touching |= used[s];
+		emit(EV_KEY, BTN_TOUCH, touching);
+		emit(EV_SYN, SYN_REPORT, 0);
+		frames++;
+	}
+
+	printf("played %d frames in %.2f s\n", frames, now_seconds() - start);
+	/* let readers drain before the device disappears */
+	sleep_seconds(settle);
+	ioctl(device, UI_DEV_DESTROY);
+	close(device);
+	fclose(file);
+	return 0;
+}